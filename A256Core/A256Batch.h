@@ -0,0 +1,242 @@
+#pragma once
+
+#include "A256Interpreter.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+// batch execution of one program over many independent inputs
+
+/*
+1) every worker thread owns a machine, a stack and a call stack, the pre-decoded program is shared read-only
+2) each job starts with zeroed registers, $01 .. $N set from its input, $NP at the program start and empty stacks
+3) each job returns exit_status, registers $01 .. $M (M = outputs) and the message of fault or exception, if any
+4) jobs are split into contiguous ranges, idle worker steals upper half of the largest remaining range
+5) run() may only be called from one thread at a time
+*/
+
+struct A256Batch
+{
+	struct A256Result
+	{
+		s64 exit_status;
+		std::vector<A256Reg> output; // registers $01 .. $M
+		std::string error; // empty if finished normally
+	};
+
+	struct A256Worker
+	{
+		std::unique_ptr<A256Machine> vm;
+		std::vector<u256> stack;
+		std::vector<u64> cstack;
+		std::mutex lock; // protects begin and end
+		size_t begin; // next job
+		size_t end;
+	};
+
+	std::vector<std::unique_ptr<A256Worker>> workers;
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	u64 generation; // incremented by run()
+	size_t running; // workers busy with current batch
+	bool quit;
+
+	// current batch
+	const A256Machine::A256Threaded* program;
+	const std::vector<std::vector<A256Reg>>* inputs;
+	std::vector<A256Result>* results;
+	u32 outputs;
+
+	A256Batch(u32 thread_count = std::thread::hardware_concurrency(), size_t stack_size = 1024 * 128)
+		: generation(0)
+		, running(0)
+		, quit(false)
+		, program(nullptr)
+		, inputs(nullptr)
+		, results(nullptr)
+		, outputs(0)
+	{
+		thread_count = std::max<u32>(thread_count, 1);
+		for (u32 i = 0; i < thread_count; i++)
+		{
+			workers.emplace_back(new A256Worker);
+			workers[i]->vm.reset(new A256Machine);
+			workers[i]->stack.resize(stack_size);
+			workers[i]->cstack.resize(stack_size);
+			workers[i]->begin = 0;
+			workers[i]->end = 0;
+		}
+		for (u32 i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back(&A256Batch::work, this, i);
+		}
+	}
+
+	A256Batch(const A256Batch&) = delete;
+	A256Batch& operator =(const A256Batch&) = delete;
+
+	~A256Batch()
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			quit = true;
+		}
+		start_cv.notify_all();
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+	}
+
+	std::vector<A256Result> run(const A256Machine::A256Threaded& program, const std::vector<std::vector<A256Reg>>& inputs, u32 outputs = 1)
+	{
+		std::vector<A256Result> res(inputs.size());
+		const size_t count = workers.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			std::lock_guard<std::mutex> l(workers[i]->lock);
+			workers[i]->begin = inputs.size() * i / count;
+			workers[i]->end = inputs.size() * (i + 1) / count;
+		}
+
+		std::unique_lock<std::mutex> l(lock);
+		this->program = &program;
+		this->inputs = &inputs;
+		this->results = &res;
+		this->outputs = std::min<u32>(outputs, 255);
+		running = count;
+		generation++;
+		start_cv.notify_all();
+		done_cv.wait(l, [&]{ return running == 0; });
+		return res;
+	}
+
+	void work(u32 id)
+	{
+		u64 done = 0; // last generation processed
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> l(lock);
+				start_cv.wait(l, [&]{ return quit || generation != done; });
+				if (quit)
+				{
+					return;
+				}
+				done = generation;
+			}
+
+			size_t job;
+			while (next(id, job))
+			{
+				execute(*workers[id], job);
+			}
+
+			std::lock_guard<std::mutex> l(lock);
+			if (--running == 0)
+			{
+				done_cv.notify_all();
+			}
+		}
+	}
+
+	bool next(u32 id, size_t& job) // take job from own range or steal
+	{
+		A256Worker& w = *workers[id];
+		{
+			std::lock_guard<std::mutex> l(w.lock);
+			if (w.begin < w.end)
+			{
+				job = w.begin++;
+				return true;
+			}
+		}
+
+		while (true)
+		{
+			// find victim (locks are never nested)
+			size_t victim = 0;
+			size_t most = 0;
+			for (size_t i = 0; i < workers.size(); i++)
+			{
+				std::lock_guard<std::mutex> l(workers[i]->lock);
+				if (workers[i]->end - workers[i]->begin > most)
+				{
+					most = workers[i]->end - workers[i]->begin;
+					victim = i;
+				}
+			}
+			if (!most)
+			{
+				return false;
+			}
+
+			size_t begin, end;
+			{
+				A256Worker& v = *workers[victim];
+				std::lock_guard<std::mutex> l(v.lock);
+				if (v.begin == v.end)
+				{
+					continue; // already taken
+				}
+				end = v.end;
+				begin = v.end - (v.end - v.begin + 1) / 2;
+				v.end = begin;
+			}
+			{
+				std::lock_guard<std::mutex> l(w.lock);
+				w.begin = begin + 1;
+				w.end = end;
+			}
+			job = begin;
+			return true;
+		}
+	}
+
+	void execute(A256Worker& w, size_t job)
+	{
+		A256Machine& vm = *w.vm;
+		const std::vector<A256Reg>& input = (*inputs)[job];
+		A256Result& res = (*results)[job];
+
+		memset(vm.reg, 0, sizeof(vm.reg));
+		for (size_t i = 0; i < input.size() && i < 255; i++)
+		{
+			vm.reg[i + 1] = input[i];
+		}
+		vm.reg[0]._uq[0] = (u64)program->base; // $NP
+		vm.reg[0]._uq[1] = (u64)w.cstack.data() + sizeof(w.cstack[0]) * w.cstack.size(); // $CS
+		vm.reg[0]._uq[2] = (u64)w.stack.data() + sizeof(w.stack[0]) * w.stack.size(); // $BP
+		vm.reg[0]._uq[3] = vm.reg[0]._uq[2]; // $SP
+		vm.exit_status = 0;
+
+		res.exit_status = 0;
+		try
+		{
+			if (vm.run(*program))
+			{
+				res.error = vm.fault_message();
+			}
+			else
+			{
+				res.exit_status = vm.exit_status;
+			}
+		}
+		catch (std::string& x)
+		{
+			res.error = x;
+		}
+		catch (std::exception& x)
+		{
+			res.error = x.what();
+		}
+		catch (...)
+		{
+			res.error = "unknown error";
+		}
+		res.output.assign(vm.reg + 1, vm.reg + 1 + outputs);
+	}
+};
@@ -4,9 +4,11 @@
 #include <stdarg.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <algorithm>
 #include <emmintrin.h>
 #include <xmmintrin.h>
+#include <immintrin.h>
 #include <memory.h>
 #include <limits>
 #include <climits>
@@ -0,0 +1,25 @@
+// superinstructions registered by A256InstrTable (included in its constructor)
+
+/*
+1) FUSE2(code, name, f1, (h1), f2, (h2)) registers superinstruction for f1 followed by f2 (FUSE3 adds f3),
+   f* are registered handlers and h* the handlers decode() selects for them (specialized variant or the same)
+2) the superinstruction keeps operands of f1, the rest of the sequence stays in place (see A256Machine::fuse2_())
+3) optimize() replaces the opcode of the first instruction of matching sequences in code
+4) name suffix gives selector kinds of a and b (f: full, i: immediate, l: lane)
+5) generated by A256Profile::fusions() from sequence counts of typical workloads, replace to tune for others
+   (names are part of A256Image::isa(), so cached images built with other sets are recompiled)
+*/
+
+// generated by A256Profile::fusions() from 142915 instructions
+FUSE3(0x0160, "subd.li+addd.ll+jrnz", subd, (sub_<s32, bscLane, bscImm>), addd, (add_<s32, bscLane, bscLane>), jrnz, (jrnz)); // 9.67% of dispatches
+FUSE2(0x0161, "subd.li+jrnz", subd, (sub_<s32, bscLane, bscImm>), jrnz, (jrnz)); // 9.49% of dispatches
+FUSE2(0x0162, "subd.li+ld", subd, (sub_<s32, bscLane, bscImm>), ld, (ld)); // 8.24% of dispatches
+FUSE2(0x0163, "muld.ff+addd.ff", muld, (mul_<s32, bscFull, bscFull>), addd, (add_<s32, bscFull, bscFull>)); // 7.34% of dispatches
+FUSE3(0x0164, "ld+stm+jrnz", ld, (ld), stm, (stm), jrnz, (jrnz)); // 7.17% of dispatches
+FUSE2(0x0165, "addd.li+jrltud.ll", addd, (add_<s32, bscLane, bscImm>), jrltud, (jrlt_<u32, bscLane, bscLane>)); // 6.99% of dispatches
+FUSE3(0x0166, "ld+ld+muld.ff", ld, (ld), ld, (ld), muld, (mul_<s32, bscFull, bscFull>)); // 4.66% of dispatches
+FUSE3(0x0167, "ld+ceqd.ff+cmovd.ff", ld, (ld), ceqd, (ceq_<s32, bscFull, bscFull>), cmovd, (cmov_<s32, bscFull, bscFull>)); // 4.66% of dispatches
+FUSE3(0x0168, "cmovd.ff+stm+jrnz", cmovd, (cmov_<s32, bscFull, bscFull>), stm, (stm), jrnz, (jrnz)); // 4.66% of dispatches
+FUSE3(0x0169, "ceqd.ff+cmovd.ff+stm", ceqd, (ceq_<s32, bscFull, bscFull>), cmovd, (cmov_<s32, bscFull, bscFull>), stm, (stm)); // 4.66% of dispatches
+FUSE3(0x016a, "subd.li+ld+stm", subd, (sub_<s32, bscLane, bscImm>), ld, (ld), stm, (stm)); // 3.58% of dispatches
+FUSE2(0x016b, "addd.ff+muld.ff", addd, (add_<s32, bscFull, bscFull>), muld, (mul_<s32, bscFull, bscFull>)); // 2.51% of dispatches
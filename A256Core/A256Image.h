@@ -0,0 +1,294 @@
+#pragma once
+
+#include "A256Interpreter.h"
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// binary image of compiled program (.a256o)
+
+/*
+1) layout: header, code (A256Cmd[]), symbols, links, string table; every section is 8-byte aligned
+2) code and data ('d') share one section, because all addressing is relative to $NP
+3) links are resolved by compile() and kept for tools only, relative code needs no fixups at load time
+4) open() maps the file copy-on-write, so the program is executed in place and may write to its own data
+5) source_hash and isa_hash allow using the image as a cache of compile() (see load()), version covers the format
+   and compile() output, so it is increased when either changes
+6) save() writes a temporary file and renames it, so readers never map a partial image
+*/
+
+struct A256ImageHeader
+{
+	char magic[4]; // "A256"
+	u32 version;
+	u64 source_hash; // hash of source text
+	u64 isa_hash; // hash of instruction table
+	u64 code_offset;
+	u64 code_count; // number of A256Cmd
+	u64 sym_offset;
+	u64 sym_count; // number of A256ImageSymbol
+	u64 link_offset;
+	u64 link_count; // number of A256ImageLink
+	u64 str_offset;
+	u64 str_size;
+};
+
+struct A256ImageSymbol
+{
+	u64 value; // see A256Machine::A256Symbol
+	u64 name; // offset of zero-terminated name in string table
+};
+
+struct A256ImageLink
+{
+	u64 pos; // instruction index
+	u64 symbol; // symbol index
+};
+
+struct A256Image
+{
+	static const u32 version = 1;
+
+	const A256ImageHeader* header;
+	const A256Cmd* code; // mapped code section
+	size_t size; // number of instructions
+	u8* memory;
+	size_t memory_size;
+	std::vector<A256Cmd> compiled; // program of load() when the image could not be saved (header is nullptr)
+	std::vector<A256Machine::A256Symbol> compiled_symbols;
+
+	A256Image()
+		: header(nullptr)
+		, code(nullptr)
+		, size(0)
+		, memory(nullptr)
+		, memory_size(0)
+	{
+	}
+
+	A256Image(const A256Image&) = delete;
+	A256Image& operator =(const A256Image&) = delete;
+
+	~A256Image()
+	{
+		close();
+	}
+
+	static u64 hash(const void* data, size_t size, u64 h = 0xcbf29ce484222325ull) // FNV-1a
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			h = (h ^ ((const u8*)data)[i]) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	static u64 isa(const A256Machine& vm) // hash of opcodes, names and operand types
+	{
+		u64 h = hash(nullptr, 0);
+		for (u32 i = 0; i <= vm.instr.max_num; i++)
+		{
+			if (vm.instr.name[i])
+			{
+				const u64 type = vm.instr.type[i];
+				h = hash(&i, sizeof(i), h);
+				h = hash(&type, sizeof(type), h);
+				h = hash(vm.instr.name[i], strlen(vm.instr.name[i]) + 1, h);
+			}
+		}
+		return h;
+	}
+
+	static bool save(const std::string& path, const std::vector<A256Cmd>& program,
+		const std::vector<A256Machine::A256Symbol>& symbols, const std::vector<A256Machine::A256Link>& links, u64 source_hash, u64 isa_hash)
+	{
+		std::vector<A256ImageSymbol> sym(symbols.size());
+		std::vector<A256ImageLink> lnk(links.size());
+		std::string str;
+		for (size_t i = 0; i < symbols.size(); i++)
+		{
+			sym[i].value = symbols[i].value;
+			sym[i].name = str.size();
+			str.append(symbols[i].name.c_str(), symbols[i].name.size() + 1);
+		}
+		for (size_t i = 0; i < links.size(); i++)
+		{
+			lnk[i].pos = links[i].pos;
+			lnk[i].symbol = links[i].symbol;
+		}
+		str.resize((str.size() + 7) & ~7);
+
+		A256ImageHeader h = {};
+		memcpy(h.magic, "A256", 4);
+		h.version = version;
+		h.source_hash = source_hash;
+		h.isa_hash = isa_hash;
+		h.code_offset = sizeof(h);
+		h.code_count = program.size();
+		h.sym_offset = h.code_offset + program.size() * sizeof(A256Cmd);
+		h.sym_count = sym.size();
+		h.link_offset = h.sym_offset + sym.size() * sizeof(A256ImageSymbol);
+		h.link_count = lnk.size();
+		h.str_offset = h.link_offset + lnk.size() * sizeof(A256ImageLink);
+		h.str_size = str.size();
+
+#ifdef _WIN32
+		const std::string temp = fmt::format("%s.%u.tmp", path.c_str(), (u32)GetCurrentProcessId());
+#else
+		const std::string temp = fmt::format("%s.%u.tmp", path.c_str(), (u32)getpid());
+#endif
+		std::ofstream f(temp, std::ios::binary | std::ios::trunc);
+		f.write((const char*)&h, sizeof(h));
+		f.write((const char*)program.data(), program.size() * sizeof(A256Cmd));
+		f.write((const char*)sym.data(), sym.size() * sizeof(A256ImageSymbol));
+		f.write((const char*)lnk.data(), lnk.size() * sizeof(A256ImageLink));
+		f.write(str.data(), str.size());
+		f.close();
+#ifdef _WIN32
+		if (!f || !MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+		if (!f || rename(temp.c_str(), path.c_str()))
+#endif
+		{
+			remove(temp.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool open(const std::string& path) // map image, false if not found or invalid
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER file_size;
+		HANDLE mapping = nullptr;
+		if (GetFileSizeEx(file, &file_size) && file_size.QuadPart >= sizeof(A256ImageHeader))
+		{
+			mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		}
+		if (mapping)
+		{
+			memory = (u8*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			memory_size = (size_t)file_size.QuadPart;
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (!fstat(fd, &st) && st.st_size >= (off_t)sizeof(A256ImageHeader))
+		{
+			void* ptr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			memory = ptr == MAP_FAILED ? nullptr : (u8*)ptr;
+			memory_size = st.st_size;
+		}
+		::close(fd);
+#endif
+		if (!memory)
+		{
+			return false;
+		}
+
+		// validate
+		const A256ImageHeader& h = *(A256ImageHeader*)memory;
+		const u64 end = memory_size;
+		if (memcmp(h.magic, "A256", 4) || h.version != version ||
+			h.code_offset % 8 || h.code_offset > end || h.code_count > (end - h.code_offset) / sizeof(A256Cmd) ||
+			h.sym_offset > end || h.sym_count > (end - h.sym_offset) / sizeof(A256ImageSymbol) ||
+			h.link_offset > end || h.link_count > (end - h.link_offset) / sizeof(A256ImageLink) ||
+			h.str_offset > end || h.str_size > end - h.str_offset)
+		{
+			close();
+			return false;
+		}
+		header = &h;
+		code = (const A256Cmd*)(memory + h.code_offset);
+		size = (size_t)h.code_count;
+		return true;
+	}
+
+	void close()
+	{
+		if (memory)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(memory);
+#else
+			munmap(memory, memory_size);
+#endif
+		}
+		header = nullptr;
+		code = nullptr;
+		size = 0;
+		memory = nullptr;
+		memory_size = 0;
+		compiled.clear();
+		compiled_symbols.clear();
+	}
+
+	std::vector<A256Machine::A256Symbol> symbols() const
+	{
+		if (!header)
+		{
+			return compiled_symbols;
+		}
+		std::vector<A256Machine::A256Symbol> res;
+		const A256ImageSymbol* sym = (const A256ImageSymbol*)(memory + header->sym_offset);
+		const char* str = (const char*)(memory + header->str_offset);
+		for (u64 i = 0; i < header->sym_count; i++)
+		{
+			if (sym[i].name >= header->str_size)
+			{
+				throw fmt::format(__FUNCTION__"(): invalid symbol name.");
+			}
+			res.push_back(A256Machine::A256Symbol({ std::string(str + sym[i].name, strnlen(str + sym[i].name, (size_t)(header->str_size - sym[i].name))), sym[i].value }));
+		}
+		return res;
+	}
+
+	bool load(A256Machine& vm, const std::string& text, const std::string& path) // map cached image of text or compile and save it (returns true if cached)
+	{
+		// any failure of the cache is a miss, the program is then kept in memory
+		const u64 source_hash = hash(text.data(), text.size());
+		const u64 isa_hash = isa(vm);
+		if (open(path) && header->source_hash == source_hash && header->isa_hash == isa_hash)
+		{
+			return true;
+		}
+		close();
+
+		std::vector<A256Machine::A256Symbol> symbols;
+		std::vector<A256Machine::A256Link> links;
+		std::vector<A256Cmd> program = vm.compile(text, &symbols, &links);
+		if (save(path, program, symbols, links, source_hash, isa_hash) && open(path) &&
+			header->source_hash == source_hash && header->isa_hash == isa_hash && size == program.size())
+		{
+			return false;
+		}
+		close();
+		compiled = std::move(program);
+		compiled_symbols = std::move(symbols);
+		code = compiled.data();
+		size = compiled.size();
+		return false;
+	}
+};
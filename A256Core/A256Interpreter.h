@@ -1,8 +1,20 @@
 #pragma once
 
-#include "A256Reg.h"
-
-#define RSAVE1(dst, src, mask) for (u32 i = 0; i < 8; i++) if ((mask) & (1 << i)) (dst)._ud[i] = (src)._ud[i];
+#include "A256Simd.h"
+#include <mutex>
+
+#ifdef A256_PROFILE
+#include "A256Profile.h"
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#define RSAVE1(dst, src, mask) (dst).save((src), (mask)) // register
+#define RSTORE1(dst, src, mask) (dst).store((src), (mask)) // memory (guest or host)
+#define op (*cur)
 
 struct A256Machine
 {
@@ -31,30 +43,252 @@ struct A256Machine
 	Registers $90 .. $9F and $01 can be used for simple leaf subroutines as the only volatile registers.
 	*/
 
+	enum A256Bsc : u32 // bsc1 selector kinds known at decode time (see src() and decode())
+	{
+		bscFull, // 0xff, register unchanged
+		bscImm, // 0xfa .. 0xfd, broadcast immediate
+		bscLane, // broadcast word, dword, qword or dqword (packing)
+		bscAny, // anything else, full bsc1 switch
+	};
+
+	enum A256Fault : u32 // run() result, fault_value meaning in brackets
+	{
+		faultNone, // exit (stop 0)
+		faultInstruction, // unregistered instruction (opcode)
+		faultBsc1, // reserved bsc1 encoding (opcode)
+		faultStopCode, // invalid stop code (code)
+		faultAssertion, // stop 0x0d on zero register (register | bsc1 code << 8)
+		faultStackPartial, // call, ret, push*, pop* with partial stack pointer mask (mask)
+		faultStackMultiple, // ret, pop* with more than one stack pointer (mask)
+		faultImmediate, // ret with nonzero immediate (immediate)
+		faultBlock, // blk* block crossing the end of guest space (address)
+		faultBudget, // instruction budget of run() exhausted, not an error: next run() resumes at fault_addr (instructions executed)
+	};
+
+	enum A256OptKind : u8 // instruction classes known to optimize()
+	{
+		okOther, // unknown effects, all registers are live
+		okOp3, // r.mask = a op b without side effects
+		okSet, // setd r.mask, imm32
+		okAddImm, // adddi r.mask, imm32 (reads r)
+		okMoveBytes, // mmovb r, a, imm32
+		okJump, // jrnz, jrz, jrall, jrnall (imm32)
+		okJump16, // jreq*, jrne*, jrlt* (imm16)
+		okLoop, // loopd, loopq (imm32, decrements r)
+		okCall, // call (imm32)
+		okRet, // ret
+		okData, // addr, ldr*, str* (imm32 relative to $NP)
+	};
+
+	typedef void (*A256Sink)(void* context, const char* data, size_t size); // host output callback
+	typedef void (A256Machine::*A256Handler)(); // instruction handler (see handler())
+
 	A256Reg reg[256]; // registers $00 .. $FF
-	A256Cmd op; // current operation (copied from memory)
+	const A256Cmd* cur; // current operation (accessed as op, not copied from memory)
 	s64 exit_status;
+	u32 fault; // A256Fault, set by trap()
+	u64 fault_addr; // faulting instruction
+	u64 fault_value;
+	u64 followed; // superinstruction parts run after the first (see follow()), charged against the run() budget
+	u64 mem_base; // guest address space (see guest() and A256Memory.h), 0 if not sandboxed
+	u64 mem_mask; // ~0 if not sandboxed (guest addresses are host pointers)
+	std::string out; // buffered output of stop codes (see print() and flush())
+	size_t out_limit; // flush when buffer reaches this size (0: unbuffered)
+	A256Sink sink; // output destination (nullptr: stdout)
+	void* sink_context;
+#ifdef A256_PROFILE
+	A256Profile profile; // see step() and execute()
+#endif
 
 	A256Machine()
+		: cur(nullptr)
+		, exit_status(0)
+		, fault(faultNone)
+		, fault_addr(0)
+		, fault_value(0)
+		, followed(0)
+		, mem_base(0)
+		, mem_mask(~0ull)
+		, out_limit(0x10000)
+		, sink(nullptr)
+		, sink_context(nullptr)
+		, instr(table())
 	{
 		memset(&reg, 0, sizeof(reg));
 	}
 
+	~A256Machine()
+	{
+		flush();
+	}
+
+	void emit(const char* data, size_t size) // send to sink, bypassing the buffer
+	{
+		if (sink)
+		{
+			sink(sink_context, data, size);
+		}
+		else
+		{
+			fwrite(data, 1, size, stdout);
+		}
+	}
+
+	void flush() // output buffered data (stop 0x00, 0x0d, 0x0f, size limit and destructor)
+	{
+		if (!out.empty())
+		{
+			emit(out.data(), out.size());
+			out.clear();
+		}
+	}
+
+	void write(const char* data, size_t size) // buffered output, large blocks are not copied
+	{
+		if (out.size() + size < out_limit)
+		{
+			out.append(data, size);
+			return;
+		}
+		flush();
+		if (size < out_limit)
+		{
+			out.append(data, size);
+		}
+		else
+		{
+			emit(data, size);
+		}
+	}
+
+	void print(const char* format, ...) // formatted output, appended to the buffer in place
+	{
+		const size_t start = out.size();
+		va_list v;
+		va_start(v, format);
+		const int count = _vscprintf(format, v); // exact size, vsnprintf_s() would abort on a short buffer
+		va_end(v);
+		if (count <= 0)
+		{
+			return;
+		}
+		out.resize(start + count + 1);
+		va_start(v, format);
+		vsnprintf_s(&out[start], count + 1, _TRUNCATE, format, v);
+		va_end(v);
+		out.resize(start + count);
+		if (out.size() >= out_limit)
+		{
+			flush();
+		}
+	}
+
+	void trap(u32 code, u64 value) // stop execution with fault, run() returns code (no exceptions in handlers)
+	{
+		fault = code;
+		fault_addr = reg[0]._uq[0] - sizeof(A256Cmd);
+		fault_value = value;
+		cur = nullptr;
+	}
+
+	std::string fault_message() const // describe fault for the host (allocates, unlike trap())
+	{
+		std::string res;
+		switch (fault)
+		{
+		case faultNone: return res;
+		case faultInstruction: res = fmt::format("invalid instruction 0x%llx", fault_value); break;
+		case faultBsc1: res = fmt::format("unsupported bsc1 encoding (instruction 0x%llx)", fault_value); break;
+		case faultStopCode: res = fmt::format("stop(): invalid code 0x%llx", fault_value); break;
+		case faultAssertion:
+		{
+			A256Reg r = reg[fault_value & 0xff];
+			res = fmt::format("[$%.2X%s] Assertion failed", (u32)(fault_value & 0xff), r.bsc1_fmt((u8)(fault_value >> 8)).c_str());
+			break;
+		}
+		case faultStackPartial: res = fmt::format("partial stack pointer update (mask 0x%llx)", fault_value); break;
+		case faultStackMultiple: res = fmt::format("multiple stack pointer update (mask 0x%llx)", fault_value); break;
+		case faultImmediate: res = fmt::format("ret(): invalid immediate 0x%llx", fault_value); break;
+		case faultBlock: res = fmt::format("block at 0x%llx crosses the end of guest space", fault_value); break;
+		case faultBudget: res = fmt::format("instruction budget exhausted (%lld instructions executed)", fault_value); break;
+		default: res = fmt::format("fault %u", fault); break;
+		}
+		return res + fmt::format(" at 0x%llx.", fault_addr);
+	}
+
+	bool stack_mask(u8 mask, bool single) // check stack pointer selection: whole qwords (only one if single)
+	{
+		for (u32 i = 0; i < 4; i++)
+		{
+			const u32 q = (mask >> (i * 2)) & 3;
+			if (q == 1 || q == 2)
+			{
+				trap(faultStackPartial, mask);
+				return false;
+			}
+			if (q == 3 && single && mask != (3 << (i * 2)))
+			{
+				trap(faultStackMultiple, mask);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<typename T>
+	T* guest(u64 addr) const // host pointer for guest address (identity if not sandboxed)
+	{
+		return (T*)(mem_base | (addr & mem_mask));
+	}
+
+	bool block(u64 addr, u64 size, u8*& ptr) // host pointer for guest block, which can't wrap around guest space
+	{
+		const u64 offset = addr & mem_mask;
+		if (size && size - 1 > mem_mask - offset)
+		{
+			trap(faultBlock, addr);
+			return false;
+		}
+		ptr = (u8*)(mem_base | offset);
+		return true;
+	}
+
+	template<typename T, u32 S>
+	A256Reg src(u8 r, u8 code) // read source operand r.bsc
+	{
+		switch (S)
+		{
+		case bscFull: return reg[r];
+		case bscImm: return A256Reg::set(A256Reg::imm<T>(code, r));
+		case bscLane: return reg[r].lane(code);
+		default: return reg[r].bsc1<T>(code, r);
+		}
+	}
+
+	static u32 bsc(u8 code) // classify bsc1 code
+	{
+		if (code == 0xff) return bscFull;
+		if (code >= 0xfa && code <= 0xfd) return bscImm;
+		if ((code & 0xf0) == 0x40 || (code & 0xf8) == 0x80 || (code & 0xfc) == 0xc0 || (code & 0xfe) == 0xe0) return bscLane;
+		return bscAny;
+	}
+
 	void stop() // interrupt (stop r.bsc, imm32)
 	{
 		switch (s32 code = op.op1i.imm)
 		{
 		case 0x00: // exit
 		{
-			(u64&)op = 0;
 			A256Reg arg1 = reg[op.op1i.r].bsc1<s64>(op.op1i.r_mask, op.op1i.r);
 			exit_status = arg1._sq[0];
+			cur = nullptr;
+			flush();
 			break;
 		}
 		case 0x01: // print f32
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<f32>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:fs %f %f %f %f %f %f %f %f\n",
+			print("[$%.2X%s]:fs %f %f %f %f %f %f %f %f\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._fs[0], arg1._fs[1], arg1._fs[2], arg1._fs[3],
 				arg1._fs[4], arg1._fs[5], arg1._fs[6], arg1._fs[7]);
@@ -63,7 +297,7 @@ struct A256Machine
 		case 0x02: // print f64
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<f64>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:fd %f %f %f %f\n",
+			print("[$%.2X%s]:fd %f %f %f %f\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._fd[0], arg1._fd[1], arg1._fd[2], arg1._fd[3]);
 			break;
@@ -71,7 +305,7 @@ struct A256Machine
 		case 0x03: // print u8
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u8>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:ub %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x "
+			print("[$%.2X%s]:ub %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x "
 				"%.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x %.2x\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._ub[0], arg1._ub[1], arg1._ub[2], arg1._ub[3],
@@ -87,7 +321,7 @@ struct A256Machine
 		case 0x04: // print s8
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<s8>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:sb %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d "
+			print("[$%.2X%s]:sb %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d "
 				"%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._sb[0], arg1._sb[1], arg1._sb[2], arg1._sb[3],
@@ -103,7 +337,7 @@ struct A256Machine
 		case 0x05: // print u16
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u16>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:uw %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x\n",
+			print("[$%.2X%s]:uw %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x %.4x\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._uw[0], arg1._uw[1], arg1._uw[2], arg1._uw[3],
 				arg1._uw[4], arg1._uw[5], arg1._uw[6], arg1._uw[7],
@@ -114,7 +348,7 @@ struct A256Machine
 		case 0x06: // print s16
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<s16>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:sw %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
+			print("[$%.2X%s]:sw %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._sw[0], arg1._sw[1], arg1._sw[2], arg1._sw[3],
 				arg1._sw[4], arg1._sw[5], arg1._sw[6], arg1._sw[7],
@@ -125,7 +359,7 @@ struct A256Machine
 		case 0x07: // print u32
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u32>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:ud %.8x %.8x %.8x %.8x %.8x %.8x %.8x %.8x\n",
+			print("[$%.2X%s]:ud %.8x %.8x %.8x %.8x %.8x %.8x %.8x %.8x\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._ud[0], arg1._ud[1], arg1._ud[2], arg1._ud[3],
 				arg1._ud[4], arg1._ud[5], arg1._ud[6], arg1._ud[7]);
@@ -134,7 +368,7 @@ struct A256Machine
 		case 0x08: // print s32
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<s32>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:sd %d %d %d %d %d %d %d %d\n",
+			print("[$%.2X%s]:sd %d %d %d %d %d %d %d %d\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._sd[0], arg1._sd[1], arg1._sd[2], arg1._sd[3],
 				arg1._sd[4], arg1._sd[5], arg1._sd[6], arg1._sd[7]);
@@ -143,7 +377,7 @@ struct A256Machine
 		case 0x09: // print u64
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:uq %.16llx %.16llx %.16llx %.16llx\n",
+			print("[$%.2X%s]:uq %.16llx %.16llx %.16llx %.16llx\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._uq[0], arg1._uq[1], arg1._uq[2], arg1._uq[3]);
 			break;
@@ -151,7 +385,7 @@ struct A256Machine
 		case 0x0a: // print s64
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<s64>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s]:sq %lld %lld %lld %lld\n",
+			print("[$%.2X%s]:sq %lld %lld %lld %lld\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._sq[0], arg1._sq[1], arg1._sq[2], arg1._sq[3]);
 			break;
@@ -159,7 +393,7 @@ struct A256Machine
 		case 0x0b: // print full data
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s] %.16llx%.16llx%.16llx%.16llx\n",
+			print("[$%.2X%s] %.16llx%.16llx%.16llx%.16llx\n",
 				op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._uq[3], arg1._uq[2], arg1._uq[1], arg1._uq[0]);
 			break;
@@ -167,29 +401,35 @@ struct A256Machine
 		case 0x0c: // print arbitrary data (uq[0] = pointer, uq[1] = length)
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
-			std::string data((const char*)arg1._uq[0], arg1._uq[1]);
-			printf("%s", data.c_str());
+			const u64 room = mem_mask - (arg1._uq[0] & mem_mask) + 1; // bytes up to the end of guest space
+			write(guest<const char>(arg1._uq[0]), (size_t)std::min(arg1._uq[1], room));
 			break;
 		}
-		case 0x0d: // throw exception if register is zero
+		case 0x0d: // trap if register is zero
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
 			if (!arg1._uq[0] && !arg1._uq[1] && !arg1._uq[2] && !arg1._uq[3])
 			{
-				throw fmt::format("[$%.2X%s] Assertion failed.", op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str());
+				trap(faultAssertion, op.op1i.r | (u32)op.op1i.r_mask << 8);
 			}
 			break;
 		}
 		case 0x0e: // test
 		{
 			A256Reg arg1 = reg[op.op1i.r].bsc1<f64>(op.op1i.r_mask, op.op1i.r);
-			printf("[$%.2X%s].fd0 = %f; acos = %f; asin = %f\n", op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
+			print("[$%.2X%s].fd0 = %f; acos = %f; asin = %f\n", op.op1i.r, arg1.bsc1_fmt(op.op1i.r_mask).c_str(),
 				arg1._fd[0], acos(arg1._fd[0]), asin(arg1._fd[0]));
 			break;
 		}
+		case 0x0f: // flush output
+		{
+			flush();
+			break;
+		}
 		default:
 		{
-			throw fmt::format(__FUNCTION__"(): invalid code 0x%x.", code);
+			trap(faultStopCode, (u32)code);
+			break;
 		}
 		}
 	}
@@ -224,12 +464,21 @@ struct A256Machine
 		}
 	}
 
-	void shufb() // shuffle bytes (shufb r.mask, a.bsc, b.bsc)
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void shufb_() // shuffle bytes (shufb r.mask, a.bsc, b.bsc), a is mask, b is data
+	{
+		A256Reg mask = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg data = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Shuffle::shufb(mask, data);
+		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+	}
+
+	void shufb()
 	{
-		// TODO
+		shufb_<u8>();
 	}
 
-	void shufbx() // advanced shuffle bytes (shufbx r, arg0, arg1, arg2, arg3, arg4)
+	void shufbx() // advanced shuffle bytes (shufbx r, arg0, arg1, arg2, arg3, arg4), arg0 is mask
 	{
 		A256Reg mask = reg[op.op6.arg[0]];
 		A256Reg data[4];
@@ -237,17 +486,7 @@ struct A256Machine
 		{
 			data[i] = reg[op.op6.arg[i + 1]];
 		}
-		for (u32 i = 0; i < 32; i++)
-		{
-			if (mask._ub[i] & 0x80)
-			{
-				reg[op.op6.r]._ub[i] = 0;
-			}
-			else
-			{
-				reg[op.op6.r]._ub[i] = data[mask._ub[i] >> 5]._ub[mask._ub[i] % 32];
-			}
-		}
+		reg[op.op6.r] = A256Shuffle::shufbx(mask, data);
 	}
 
 	void jrnz() // jump relatively if not zero (jrnz a.bsc, imm32)
@@ -276,12 +515,122 @@ struct A256Machine
 		reg[0]._uq[0] += (s32)op.op1i.imm;
 	}
 
+	void loopd() // decrement dwords and jump relatively if any is not zero (loopd r.mask, imm32)
+	{
+		A256Reg& counter = reg[op.op1i.r];
+		u32 nz = 0;
+		for (u32 i = 0; i < 8; i++)
+		{
+			if (op.op1i.r_mask & (1 << i))
+			{
+				nz |= --counter._ud[i];
+			}
+		}
+		if (nz)
+		{
+			reg[0]._uq[0] += (s32)op.op1i.imm;
+		}
+	}
+
+	void loopq() // decrement qwords and jump relatively if any is not zero (loopq r.mask, imm32)
+	{
+		A256Reg& counter = reg[op.op1i.r];
+		u64 nz = 0;
+		for (u32 i = 0; i < 4; i++)
+		{
+			if (op.op1i.r_mask & (3 << (i * 2)))
+			{
+				nz |= --counter._uq[i];
+			}
+		}
+		if (nz)
+		{
+			reg[0]._uq[0] += (s32)op.op1i.imm;
+		}
+	}
+
+	void jrall() // jump relatively if all bits are set (jrall a.bsc, imm32)
+	{
+		A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
+		if ((arg1._uq[0] & arg1._uq[1] & arg1._uq[2] & arg1._uq[3]) == ~0ull)
+		{
+			reg[0]._uq[0] += (s32)op.op1i.imm;
+		}
+	}
+
+	void jrnall() // jump relatively if not all bits are set (jrnall a.bsc, imm32)
+	{
+		A256Reg arg1 = reg[op.op1i.r].bsc1<u64>(op.op1i.r_mask, op.op1i.r);
+		if ((arg1._uq[0] & arg1._uq[1] & arg1._uq[2] & arg1._uq[3]) != ~0ull)
+		{
+			reg[0]._uq[0] += (s32)op.op1i.imm;
+		}
+	}
+
+	static bool any(const A256Reg& mask)
+	{
+		return (mask._uq[0] | mask._uq[1] | mask._uq[2] | mask._uq[3]) != 0;
+	}
+
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void jreq_() // jump relatively if all elements are equal (jreq* a.bsc, b.bsc, imm16)
+	{
+		A256Reg arg1 = src<T, Sa>(op.op2j.a, op.op2j.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op2j.b, op.op2j.b_mask);
+		if (!memcmp(&arg1, &arg2, sizeof(A256Reg)))
+		{
+			reg[0]._uq[0] += op.op2j.imm;
+		}
+	}
+
+	void jreqd()
+	{
+		jreq_<u32>();
+	}
+
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void jrne_() // jump relatively if any element is not equal (jrne* a.bsc, b.bsc, imm16)
+	{
+		A256Reg arg1 = src<T, Sa>(op.op2j.a, op.op2j.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op2j.b, op.op2j.b_mask);
+		if (memcmp(&arg1, &arg2, sizeof(A256Reg)))
+		{
+			reg[0]._uq[0] += op.op2j.imm;
+		}
+	}
+
+	void jrned()
+	{
+		jrne_<u32>();
+	}
+
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void jrlt_() // jump relatively if any element of a is less than element of b (jrlt* a.bsc, b.bsc, imm16)
+	{
+		A256Reg arg1 = src<T, Sa>(op.op2j.a, op.op2j.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op2j.b, op.op2j.b_mask);
+		if (any(A256Simd<T>::cgt(arg2, arg1)))
+		{
+			reg[0]._uq[0] += op.op2j.imm;
+		}
+	}
+
+	void jrltsd()
+	{
+		jrlt_<s32>();
+	}
+
+	void jrltud()
+	{
+		jrlt_<u32>();
+	}
+
 	template<typename T>
 	void ld_() // load (and broadcast) (ld* r.mask, a.bsc, b.bsc)
 	{
 		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg arg2 = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg data = A256Reg::set(*(T*)(arg1._uq[0] + arg2._uq[0]));
+		A256Reg data = A256Reg::set(*guest<T>(arg1._uq[0] + arg2._uq[0]));
 		RSAVE1(reg[op.op3.r], data, op.op3.r_mask);
 	}
 
@@ -320,8 +669,8 @@ struct A256Machine
 		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg arg2 = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
 		u64 addr = arg1._uq[0] + arg2._uq[0];
-		A256Reg* data = (A256Reg*)addr;
-		RSAVE1(*data, reg[op.op3.r], op.op3.r_mask);
+		A256Reg* data = guest<A256Reg>(addr);
+		RSTORE1(*data, reg[op.op3.r], op.op3.r_mask);
 	}
 
 	template<typename T, typename Tr = T>
@@ -330,7 +679,7 @@ struct A256Machine
 		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg arg2 = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
 		A256Reg data = reg[op.op3.r].bsc1<Tr>(op.op3.r_mask, op.op3.r);
-		*(T*)(arg1._uq[0] + arg2._uq[0]) = (T&)data;
+		*guest<T>(arg1._uq[0] + arg2._uq[0]) = (T&)data;
 	}
 
 	void stfs()
@@ -368,10 +717,119 @@ struct A256Machine
 		st_<s64>();
 	}
 
+	template<typename T>
+	void gather_() // load lanes from a + b * sizeof(T) (gather* r.mask, a.bsc, b.bsc), see A256Gather
+	{
+		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
+		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg data = A256Gather<T>::gather(reg[op.op3.r], arg1._uq[0], arg2, op.op3.r_mask, mem_base, mem_mask);
+		RSAVE1(reg[op.op3.r], data, op.op3.r_mask);
+	}
+
+	void gatherfs()
+	{
+		gather_<u32>();
+	}
+
+	void gatherfd()
+	{
+		gather_<u64>();
+	}
+
+	void gatherd()
+	{
+		gather_<u32>();
+	}
+
+	void gatherq()
+	{
+		gather_<u64>();
+	}
+
+	template<typename T>
+	void scatter_() // store lanes to a + b * sizeof(T) (scatter* r.mask, a.bsc, b.bsc), see A256Gather
+	{
+		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
+		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Gather<T>::scatter(reg[op.op3.r], arg1._uq[0], arg2, op.op3.r_mask, mem_base, mem_mask);
+	}
+
+	void scatterfs()
+	{
+		scatter_<u32>();
+	}
+
+	void scatterfd()
+	{
+		scatter_<u64>();
+	}
+
+	void scatterd()
+	{
+		scatter_<u32>();
+	}
+
+	void scatterq()
+	{
+		scatter_<u64>();
+	}
+
+	void blkcpy() // copy block (blkcpy d.bsc, s.bsc, n.bsc), blocks should not overlap
+	{
+		A256Reg dst = reg[op.op3.r].bsc1<u64>(op.op3.r_mask, op.op3.r);
+		A256Reg src = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
+		A256Reg size = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		u8* d;
+		u8* s;
+		if (block(dst._uq[0], size._uq[0], d) && block(src._uq[0], size._uq[0], s))
+		{
+			A256Bulk::copy(d, s, size._uq[0]);
+		}
+	}
+
+	void blkmov() // copy block, blocks may overlap (blkmov d.bsc, s.bsc, n.bsc)
+	{
+		A256Reg dst = reg[op.op3.r].bsc1<u64>(op.op3.r_mask, op.op3.r);
+		A256Reg src = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
+		A256Reg size = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		u8* d;
+		u8* s;
+		if (block(dst._uq[0], size._uq[0], d) && block(src._uq[0], size._uq[0], s))
+		{
+			A256Bulk::move(d, s, size._uq[0]);
+		}
+	}
+
+	void blkset() // fill block with repeated 32-byte pattern (blkset d.bsc, p.bsc, n.bsc)
+	{
+		A256Reg dst = reg[op.op3.r].bsc1<u64>(op.op3.r_mask, op.op3.r);
+		A256Reg pattern = reg[op.op3.a].bsc1<u8>(op.op3.a_mask, op.op3.a);
+		A256Reg size = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		u8* d;
+		if (block(dst._uq[0], size._uq[0], d))
+		{
+			A256Bulk::fill(d, pattern, size._uq[0]);
+		}
+	}
+
+	void blkcmp() // compare blocks at a.uq0 and a.uq1 (blkcmp r.mask, a.bsc, b.bsc), r.uq0 = first different byte or b, r.sq1 = sign
+	{
+		A256Reg ptr = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
+		A256Reg size = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		u8* a;
+		u8* b;
+		if (block(ptr._uq[0], size._uq[0], a) && block(ptr._uq[1], size._uq[0], b))
+		{
+			A256Reg result = A256Reg::set<u64>(0);
+			result._uq[0] = A256Bulk::compare(a, b, size._uq[0], result._sq[1]);
+			RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		}
+	}
+
 	template<typename T>
 	void ldr_() // load relatively (and broadcast) (ldr* r.mask, imm32)
 	{
-		A256Reg data = A256Reg::set(*(T*)(reg[0]._uq[0] + (s32)op.op1i.imm));
+		A256Reg data = A256Reg::set(*guest<T>(reg[0]._uq[0] + (s32)op.op1i.imm));
 		RSAVE1(reg[op.op3.r], data, op.op1i.r_mask);
 	}
 
@@ -408,15 +866,15 @@ struct A256Machine
 	void strm() // store relatively with mask (str r.mask, imm32)
 	{
 		u64 addr = reg[0]._uq[0] + (s32)op.op1i.imm;
-		A256Reg* data = (A256Reg*)addr;
-		RSAVE1(*data, reg[op.op3.r], op.op1i.r_mask);
+		A256Reg* data = guest<A256Reg>(addr);
+		RSTORE1(*data, reg[op.op3.r], op.op1i.r_mask);
 	}
 
 	template<typename T, typename Tr = T>
 	void str_() // store relatively (str* r.bsc, imm32)
 	{
 		A256Reg data = reg[op.op1i.r].bsc1<Tr>(op.op1i.r_mask, op.op1i.r);
-		*(T*)(reg[0]._uq[0] + (s32)op.op1i.imm) = (T&)data;
+		*guest<T>(reg[0]._uq[0] + (s32)op.op1i.imm) = (T&)data;
 	}
 
 	void strfs()
@@ -454,11 +912,11 @@ struct A256Machine
 		str_<s64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void cmov_() // conditional move if not zero (cmov* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result = reg[op.op3.r];
 		for (u32 i = 0; i < 32 / sizeof(T); i++)
 		{
@@ -490,11 +948,11 @@ struct A256Machine
 		cmov_<s64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void cmovz_() // conditional move if zero (cmovz* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result = reg[op.op3.r];
 		for (u32 i = 0; i < 32 / sizeof(T); i++)
 		{
@@ -526,16 +984,12 @@ struct A256Machine
 		cmovz_<s64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void add_() // addition (add* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			result.get<T>(i) = (arg1.get<T>(i)) + (arg2.get<T>(i));
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::add(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
@@ -622,16 +1076,12 @@ struct A256Machine
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void sub_() // subtract (sub* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			result.get<T>(i) = (arg1.get<T>(i)) - (arg2.get<T>(i));
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::sub(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
@@ -665,11 +1115,11 @@ struct A256Machine
 		sub_<s64>();
 	}
 
-	template<typename T, typename Tu>
+	template<typename T, typename Tu, u32 Sa = bscAny, u32 Sb = bscAny>
 	void cadd_() // carry of addition (cadd* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 32 / sizeof(T); i++)
 		{
@@ -700,16 +1150,12 @@ struct A256Machine
 		cadd_<s64, u64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void mul_() // multiply (sub* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			result.get<T>(i) = (arg1.get<T>(i)) * (arg2.get<T>(i));
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::mul(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
@@ -743,100 +1189,53 @@ struct A256Machine
 		mul_<s64>();
 	}
 
-	void mulhsb()
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void mulh_() // multiply high (mulh* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<s8>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<s8>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32; i++)
-		{
-			result.get<s8>(i) = ((s16)(arg1.get<s8>(i)) * (s16)(arg2.get<s8>(i))) >> 8;
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::mulh(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
+	void mulhsb()
+	{
+		mulh_<s8>();
+	}
+
 	void mulhsw()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<s16>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<s16>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 16; i++)
-		{
-			result.get<s16>(i) = ((s32)(arg1.get<s16>(i)) * (s32)(arg2.get<s16>(i))) >> 16;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<s16>();
 	}
 
 	void mulhsd()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<s32>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<s32>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 8; i++)
-		{
-			result.get<s32>(i) = ((s64)(arg1.get<s32>(i)) * (s64)(arg2.get<s32>(i))) >> 32;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<s32>();
 	}
 
 	void mulhsq()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<s64>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<s64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			result.get<s64>(i) = __mulh(arg1.get<s64>(i), arg2.get<s64>(i));
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<s64>();
 	}
 
 	void mulhub()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<u8>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<u8>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32; i++)
-		{
-			result.get<u8>(i) = ((u16)(arg1.get<u8>(i)) * (u16)(arg2.get<u8>(i))) >> 8;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<u8>();
 	}
 
 	void mulhuw()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<u16>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<u16>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 16; i++)
-		{
-			result.get<u16>(i) = ((u32)(arg1.get<u16>(i)) * (u32)(arg2.get<u16>(i))) >> 16;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<u16>();
 	}
 
 	void mulhud()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<u32>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<u32>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 8; i++)
-		{
-			result.get<u32>(i) = ((u64)(arg1.get<u32>(i)) * (u64)(arg2.get<u32>(i))) >> 32;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<u32>();
 	}
 
 	void mulhuq()
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			result.get<u64>(i) = __umulh(arg1.get<u64>(i), arg2.get<u64>(i));
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		mulh_<u64>();
 	}
 
 	template<typename T>
@@ -885,18 +1284,16 @@ struct A256Machine
 
 	void call() // jump relative using call stack (r) (call r.mask, imm32)
 	{
+		if (!stack_mask(op.op1i.r_mask, false))
+		{
+			return;
+		}
 		for (u32 i = 0; i < 4; i++)
 		{
-			switch ((op.op1i.r_mask >> (i * 2)) & 3)
-			{
-			case 0: break;
-			case 3:
+			if ((op.op1i.r_mask >> (i * 2)) & 3)
 			{
 				reg[op.op1i.r]._uq[i] -= sizeof(u64);
-				*(u64*)(reg[op.op1i.r]._uq[i]) = reg[0]._uq[0];
-				break;
-			}
-			default: throw fmt::format(__FUNCTION__"(): partial stack pointer update.");
+				*guest<u64>(reg[op.op1i.r]._uq[i]) = reg[0]._uq[0];
 			}
 		}
 		reg[0]._uq[0] += (s32)op.op1i.imm;
@@ -906,33 +1303,28 @@ struct A256Machine
 	{
 		if (op.op1i.imm != 0)
 		{
-			throw fmt::format(__FUNCTION__"(): invalid immediate 0x%x.", op.op1i.imm);
+			trap(faultImmediate, op.op1i.imm);
+			return;
+		}
+		if (!stack_mask(op.op1i.r_mask, true))
+		{
+			return;
 		}
 		for (u32 i = 0; i < 4; i++)
 		{
-			switch ((op.op1i.r_mask >> (i * 2)) & 3)
-			{
-			case 0: break;
-			case 3:
+			if ((op.op1i.r_mask >> (i * 2)) & 3)
 			{
-				if (op.op1i.r_mask != (3 << (i * 2)))
-				{
-					throw fmt::format(__FUNCTION__"(): multiple stack pointer update.");
-				}
-				reg[0]._uq[0] = *(u64*)(reg[op.op1i.r]._uq[i]);
+				reg[0]._uq[0] = *guest<u64>(reg[op.op1i.r]._uq[i]);
 				reg[op.op1i.r]._uq[i] += sizeof(u64);
-				break;
-			}
-			default: throw fmt::format(__FUNCTION__"(): partial stack pointer update.");
 			}
 		}
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void and_() // bitwise and (and* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result = arg1 & arg2;
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
@@ -972,20 +1364,18 @@ struct A256Machine
 	{
 		A256Reg value = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg align = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		if (!stack_mask(op.op3.r_mask, false))
+		{
+			return;
+		}
 		for (u32 i = 0; i < 4; i++)
 		{
-			switch ((op.op3.r_mask >> (i * 2)) & 3)
-			{
-			case 0: break;
-			case 3:
+			if ((op.op3.r_mask >> (i * 2)) & 3)
 			{
 				u64& stack = reg[op.op3.r]._uq[i];
 				stack -= sizeof(T);
 				stack &= align._uq[0];
-				*(T*)(stack) = *(T*)&value;
-				break;
-			}
-			default: throw fmt::format(__FUNCTION__"(): partial stack pointer update.");
+				*guest<T>(stack) = *(T*)&value;
 			}
 		}
 	}
@@ -1010,11 +1400,11 @@ struct A256Machine
 		push_<u256>();
 	}
 	
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void or_() // bitwise or (or* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result = arg1 | arg2;
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
@@ -1053,24 +1443,18 @@ struct A256Machine
 	void pop_() // pop value to (a) from stack (r) (pop* r.mask, a.mask, b.bsc)
 	{
 		A256Reg arg2 = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b); // ???
+		if (!stack_mask(op.op3.r_mask, true))
+		{
+			return;
+		}
 		for (u32 i = 0; i < 4; i++)
 		{
-			switch ((op.op3.r_mask >> (i * 2)) & 3)
-			{
-			case 0: break;
-			case 3:
+			if ((op.op3.r_mask >> (i * 2)) & 3)
 			{
-				if (op.op3.r_mask != (3 << (i * 2)))
-				{
-					throw fmt::format(__FUNCTION__"(): multiple stack pointer update.");
-				}
 				u64& stack = reg[op.op3.r]._uq[i];
-				A256Reg res = A256Reg::set(*(T*)(stack));
+				A256Reg res = A256Reg::set(*guest<T>(stack));
 				stack += sizeof(T);
 				RSAVE1(reg[op.op3.a], res, op.op3.a_mask);
-				break;
-			}
-			default: throw fmt::format(__FUNCTION__"(): partial stack pointer update.");
 			}
 		}
 	}
@@ -1095,11 +1479,11 @@ struct A256Machine
 		pop_<u256>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void xor_() // bitwise xor (xor* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result = arg1 ^ arg2;
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
@@ -1134,11 +1518,11 @@ struct A256Machine
 		xor_<s64>();
 	}
 
-	template<typename T, typename Tab>
+	template<typename T, typename Tab, u32 Sa = bscAny, u32 Sb = bscAny>
 	void unpk_() // interleave elements in a._dq[0] with b._dq[0] to (r) (unpk* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<Tab>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<Tab>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<Tab, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<Tab, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 16 / sizeof(T); i++)
 		{
@@ -1183,11 +1567,11 @@ struct A256Machine
 		unpk_<u64, s64>();
 	}
 
-	template<typename T, typename Tab, u32 high>
+	template<typename T, typename Tab, u32 high, u32 Sa = bscAny, u32 Sb = bscAny>
 	void pack_() // pack low or high parts of elements in (a) to r._dq[0], and (b) to r._dq[1] (pack* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<Tab>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<Tab>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<Tab, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<Tab, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 16 / sizeof(T); i++)
 		{
@@ -1267,11 +1651,11 @@ struct A256Machine
 		pack_<u64, s64, 1>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void div_() // divide (div* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 32 / sizeof(T); i++)
 		{
@@ -1330,19 +1714,12 @@ struct A256Machine
 		div_<u64>();
 	}
 
-	template<typename Ta, typename T>
+	template<typename Ta, typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void rl_() // rotate left (rl* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg = reg[op.op3.a].bsc1<Ta>(op.op3.a_mask, op.op3.a);
-		A256Reg rot = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			const u8 r = (u8)rot.get<T>(i) & (8 * sizeof(T) - 1);
-			const T v = arg.get<T>(i);
-			result.get<T>(i) = r ? (v << r) | (v << (8 * sizeof(T) - r)) : v;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg arg = src<Ta, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg count = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		RSAVE1(reg[op.op3.r], A256Shift<T>::rl(arg, count), op.op3.r_mask);
 	}
 
 	void rlfs()
@@ -1358,32 +1735,15 @@ struct A256Machine
 	void rldq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		A256Reg rot = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 j = 0; j < 4; j += 2)
-		{
-			const u8 qrot = (rot._uq[j] >> 6) & 1;
-			const u8 brot = rot._uq[j] & 63;
-			for (u32 i = 0; i < 2; i++)
-			{
-				result._uq[i + j] = (arg._uq[i ^ qrot + j] << brot) | (brot ? (arg._uq[i ^ qrot ^ 1 + j] >> (64 - brot)) : 0);
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		RSAVE1(reg[op.op3.r], A256Wide::rldq(arg, shift), op.op3.r_mask);
 	}
 
 	void rlqq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		const u8 rot = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b)._ub[0];
-		const u8 qrot = rot >> 6;
-		const u8 brot = rot & 63;
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			result._uq[i] = (arg._uq[(i - qrot) & 3] << brot) | (brot ? (arg._uq[(i - qrot - 1) & 3] >> (64 - brot)) : 0);
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		RSAVE1(reg[op.op3.r], A256Wide::rlqq(arg, shift), op.op3.r_mask);
 	}
 
 	void rlb()
@@ -1406,19 +1766,12 @@ struct A256Machine
 		rl_<s64, u64>();
 	}
 
-	template<typename Ta, typename T>
+	template<typename Ta, typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void sll_() // shift logical left (sll* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg = reg[op.op3.a].bsc1<Ta>(op.op3.a_mask, op.op3.a);
-		A256Reg shift = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			const T s = shift.get<T>(i);
-			const T v = arg.get<T>(i);
-			result.get<T>(i) = (s >= 8 * sizeof(T)) ? 0 : v << s;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg arg = src<Ta, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg shift = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		RSAVE1(reg[op.op3.r], A256Shift<T>::sll(arg, shift), op.op3.r_mask);
 	}
 
 	void sllfs()
@@ -1435,53 +1788,14 @@ struct A256Machine
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 j = 0; j < 4; j += 2)
-		{
-			const u64 qshift = shift._uq[j] >> 6;
-			const u64 bshift = shift._uq[j] & 63;
-			for (u32 i = 0; i < 2; i++)
-			{
-				if (qshift > i)
-				{
-					result._uq[i + j] = 0;
-				}
-				else if (qshift == i)
-				{
-					result._uq[i + j] = (arg._uq[j] << bshift);
-				}
-				else
-				{
-					result._uq[i + j] = (arg._uq[i + j] << bshift) | (bshift ? (arg._uq[i + 1 + j] >> (64 - bshift)) : 0);
-				}
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		RSAVE1(reg[op.op3.r], A256Wide::slldq(arg, shift), op.op3.r_mask);
 	}
 
 	void sllqq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		const u64 shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b)._uq[0];
-		const u64 qshift = shift >> 6;
-		const u64 bshift = shift & 63;
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			if (qshift > i)
-			{
-				result._uq[i] = 0;
-			}
-			else if (qshift == i)
-			{
-				result._uq[i] = (arg._uq[0] << bshift);
-			}
-			else
-			{
-				result._uq[i] = (arg._uq[(i - qshift) & 3] << bshift) | (bshift ? (arg._uq[(i - qshift - 1) & 3] >> (64 - bshift)) : 0);
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		RSAVE1(reg[op.op3.r], A256Wide::sllqq(arg, shift), op.op3.r_mask);
 	}
 
 	void sllb()
@@ -1504,117 +1818,64 @@ struct A256Machine
 		sll_<s64, u64>();
 	}
 
-	template<typename Ta, typename T, typename Ts>
+	template<typename Ta, typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void sar_() // shift arithmetical right (replicating sign bit) (sar* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg = reg[op.op3.a].bsc1<Ta>(op.op3.a_mask, op.op3.a);
-		A256Reg shift = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			const T s = shift.get<T>(i);
-			const Ts v = arg.get<Ts>(i);
-			result.get<Ts>(i) = (s >= 8 * sizeof(T)) ? v >> (8 * sizeof(T) - 1) : v >> s;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg arg = src<Ta, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg shift = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		RSAVE1(reg[op.op3.r], A256Shift<T>::sar(arg, shift), op.op3.r_mask);
 	}
 
 	void sarfs()
 	{
-		sar_<f32, u32, s32>();
+		sar_<f32, u32>();
 	}
 
 	void sarfd()
 	{
-		sar_<f64, u64, s64>();
+		sar_<f64, u64>();
 	}
 
 	void sardq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 j = 0; j < 4; j += 2)
-		{
-			const u64 qshift = shift._uq[j] >> 6;
-			const u64 bshift = shift._uq[j] & 63;
-			for (u32 i = 0; i < 2; i++)
-			{
-				if (qshift + i > 1)
-				{
-					result._uq[i + j] = (arg._sq[1 + j] >> 63);
-				}
-				else if (qshift + i == 1)
-				{
-					result._uq[i + j] = (arg._sq[1 + j] >> bshift);
-				}
-				else
-				{
-					result._uq[i + j] = (arg._uq[i + j] >> bshift) | (bshift ? (arg._uq[i + 1 + j] << (64 - bshift)) : 0);
-				}
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		RSAVE1(reg[op.op3.r], A256Wide::sardq(arg, shift), op.op3.r_mask);
 	}
 
 	void sarqq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		const u64 shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b)._uq[0];
-		const u64 qshift = shift >> 6;
-		const u64 bshift = shift & 63;
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			if (qshift + i > 3)
-			{
-				result._uq[i] = arg._sq[3] >> 63;
-			}
-			else if (qshift + i == 3)
-			{
-				result._uq[i] = (arg._sq[3] >> bshift);
-			}
-			else
-			{
-				result._uq[i] = (arg._uq[(i + qshift) & 3] >> bshift) | (bshift ? (arg._uq[(i + qshift + 1) & 3] << (64 - bshift)) : 0);
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		RSAVE1(reg[op.op3.r], A256Wide::sarqq(arg, shift), op.op3.r_mask);
 	}
 
 	void sarb()
 	{
-		sar_<s8, u8, s8>();
+		sar_<s8, u8>();
 	}
 
 	void sarw()
 	{
-		sar_<s16, u16, s16>();
+		sar_<s16, u16>();
 	}
 
 	void sard()
 	{
-		sar_<s32, u32, s32>();
+		sar_<s32, u32>();
 	}
 
 	void sarq()
 	{
-		sar_<s64, u64, s64>();
+		sar_<s64, u64>();
 	}
 
-	template<typename Ta, typename T>
+	template<typename Ta, typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void slr_() // shift logical right (slr* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg = reg[op.op3.a].bsc1<Ta>(op.op3.a_mask, op.op3.a);
-		A256Reg shift = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			const T s = shift.get<T>(i);
-			const T v = arg.get<T>(i);
-			result.get<T>(i) = (s >= 8 * sizeof(T)) ? 0 : v >> s;
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg arg = src<Ta, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg shift = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		RSAVE1(reg[op.op3.r], A256Shift<T>::slr(arg, shift), op.op3.r_mask);
 	}
 
 	void slrfs()
@@ -1631,53 +1892,14 @@ struct A256Machine
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
 		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 j = 0; j < 4; j += 2)
-		{
-			const u64 qshift = shift._uq[j] >> 6;
-			const u64 bshift = shift._uq[j] & 63;
-			for (u32 i = 0; i < 2; i++)
-			{
-				if (qshift + i > 1)
-				{
-					result._uq[i + j] = 0;
-				}
-				else if (qshift + i == 1)
-				{
-					result._uq[i + j] = (arg._uq[1 + j] >> bshift);
-				}
-				else
-				{
-					result._uq[i + j] = (arg._uq[i + j] >> bshift) | (bshift ? (arg._uq[i + 1 + j] << (64 - bshift)) : 0);
-				}
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		RSAVE1(reg[op.op3.r], A256Wide::slrdq(arg, shift), op.op3.r_mask);
 	}
 
 	void slrqq()
 	{
 		A256Reg arg = reg[op.op3.a].bsc1<u64>(op.op3.a_mask, op.op3.a);
-		const u64 shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b)._uq[0];
-		const u64 qshift = shift >> 6;
-		const u64 bshift = shift & 63;
-		A256Reg result;
-		for (u32 i = 0; i < 4; i++)
-		{
-			if (qshift + i > 3)
-			{
-				result._uq[i] = 0;
-			}
-			else if (qshift + i == 3)
-			{
-				result._uq[i] = (arg._uq[3] >> bshift);
-			}
-			else
-			{
-				result._uq[i] = (arg._uq[(i + qshift) & 3] >> bshift) | (bshift ? (arg._uq[(i + qshift + 1) & 3] << (64 - bshift)) : 0);
-			}
-		}
-		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
+		A256Reg shift = reg[op.op3.b].bsc1<u64>(op.op3.b_mask, op.op3.b);
+		RSAVE1(reg[op.op3.r], A256Wide::slrqq(arg, shift), op.op3.r_mask);
 	}
 
 	void slrb()
@@ -1700,27 +1922,23 @@ struct A256Machine
 		slr_<s64, u64>();
 	}
 
-	template<typename T, typename Tr = T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void ceq_() // compare if equal (ceq* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			result.get<Tr>(i) = (arg1.get<T>(i)) == (arg2.get<T>(i)) ? ~(Tr)0 : (Tr)0;
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::ceq(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
 	void ceqfs()
 	{
-		ceq_<f32, u32>();
+		ceq_<f32>();
 	}
 
 	void ceqfd()
 	{
-		ceq_<f64, u64>();
+		ceq_<f64>();
 	}
 
 	void ceqb()
@@ -1743,27 +1961,23 @@ struct A256Machine
 		ceq_<s64>();
 	}
 
-	template<typename T, typename Tr = T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void cgt_() // compare if greater than (cgt* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			result.get<Tr>(i) = (arg1.get<T>(i)) > (arg2.get<T>(i)) ? ~(Tr)0 : (Tr)0;
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::cgt(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
 	void cgtfs()
 	{
-		cgt_<f32, u32>();
+		cgt_<f32>();
 	}
 
 	void cgtfd()
 	{
-		cgt_<f64, u64>();
+		cgt_<f64>();
 	}
 
 	void cgtsb()
@@ -1806,18 +2020,12 @@ struct A256Machine
 		cgt_<u64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void min_() // select min value (min* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			T v1 = arg1.get<T>(i);
-			T v2 = arg2.get<T>(i);
-			result.get<T>(i) = v1 < v2 ? v1 : v2;
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::min(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 
@@ -1871,18 +2079,12 @@ struct A256Machine
 		min_<u64>();
 	}
 
-	template<typename T>
-	void max_() // select max value (min* r.mask, a.bsc, b.bsc)
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
+	void max_() // select max value (max* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
-		A256Reg result;
-		for (u32 i = 0; i < 32 / sizeof(T); i++)
-		{
-			T v1 = arg1.get<T>(i);
-			T v2 = arg2.get<T>(i);
-			result.get<T>(i) = v1 > v2 ? v1 : v2;
-		}
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
+		A256Reg result = A256Simd<T>::max(arg1, arg2);
 		RSAVE1(reg[op.op3.r], result, op.op3.r_mask);
 	}
 	
@@ -1936,11 +2138,11 @@ struct A256Machine
 		max_<u64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void hadd_() // horizontal add (hadd* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 16 / sizeof(T); i++)
 		{
@@ -1980,11 +2182,11 @@ struct A256Machine
 		hadd_<s64>();
 	}
 
-	template<typename T>
+	template<typename T, u32 Sa = bscAny, u32 Sb = bscAny>
 	void hsub_() // horizontal subtract (hadd* r.mask, a.bsc, b.bsc)
 	{
-		A256Reg arg1 = reg[op.op3.a].bsc1<T>(op.op3.a_mask, op.op3.a);
-		A256Reg arg2 = reg[op.op3.b].bsc1<T>(op.op3.b_mask, op.op3.b);
+		A256Reg arg1 = src<T, Sa>(op.op3.a, op.op3.a_mask);
+		A256Reg arg2 = src<T, Sb>(op.op3.b, op.op3.b_mask);
 		A256Reg result;
 		for (u32 i = 0; i < 16 / sizeof(T); i++)
 		{
@@ -2035,6 +2237,7 @@ struct A256Machine
 		itOp1_m1_imm16x2,
 		itOp1_bsc1_imm32,
 		itOp2_imm32,
+		itOp2_bsc2_imm16,
 		itOp3_m1_bsc2,
 		itOp3_m2_bsc1,
 		itOp3_bsc3,
@@ -2042,12 +2245,34 @@ struct A256Machine
 		itOp6,
 	};
 
-	const struct A256InstrTable
+	struct A256InstrTable // one for all machines (see table())
 	{
 		void (A256Machine::*func[0x10000])();
 		char* name[0x10000];
 		A256InstrType type[0x10000];
+		u8 spec[0x10000]; // index of specialized variants (0 if none)
+		void (A256Machine::*variant[0x100][3][3])(); // handlers specialized for [a][b] selector kinds
+		char* variant_name[0x100]; // template and its type arguments, e.g. "add_<s32" (for A256Profile::fusions())
+		u32 variant_num;
 		u32 max_num;
+		std::unordered_map<std::string, u16> opcodes; // name -> opcode (for compile())
+		std::unordered_map<std::string, u16> handlers; // func -> opcode (for find())
+
+		struct A256Fusion // superinstruction (see A256Fused.h and fuse2_())
+		{
+			u16 code;
+			u32 length; // 2 or 3
+			void (A256Machine::*parts[3])(); // handlers selected by decode() for the sequence
+			void (A256Machine::*generic[3])(); // registered handlers
+			u16 seq[3]; // opcodes
+		};
+
+		std::vector<A256Fusion> fusions; // longest first, then in registration order
+
+		static std::string key(void (A256Machine::*f)()) // member pointers are not hashable, use their bytes (may miss, see find())
+		{
+			return std::string((const char*)&f, sizeof(f));
+		}
 
 		A256InstrTable()
 		{
@@ -2055,8 +2280,10 @@ struct A256Machine
 			{
 				func[i] = nullptr;
 				name[i] = nullptr;
+				spec[i] = 0;
 			}
 
+			variant_num = 1;
 			max_num = 0;
 
 #define REG(code, f, t) \
@@ -2067,34 +2294,48 @@ struct A256Machine
 	type[code] = t; \
 	max_num = std::max<u32>(code, max_num)
 
+#define REG3(code, f, t, tmpl, ...) \
+	REG(code, f, t); \
+	spec[code] = (u8)variant_num++; \
+	variant_name[spec[code]] = #tmpl "<" #__VA_ARGS__; \
+	variant[spec[code]][bscFull][bscFull] = &A256Machine::tmpl<__VA_ARGS__, bscFull, bscFull>; \
+	variant[spec[code]][bscFull][bscImm] = &A256Machine::tmpl<__VA_ARGS__, bscFull, bscImm>; \
+	variant[spec[code]][bscFull][bscLane] = &A256Machine::tmpl<__VA_ARGS__, bscFull, bscLane>; \
+	variant[spec[code]][bscImm][bscFull] = &A256Machine::tmpl<__VA_ARGS__, bscImm, bscFull>; \
+	variant[spec[code]][bscImm][bscImm] = &A256Machine::tmpl<__VA_ARGS__, bscImm, bscImm>; \
+	variant[spec[code]][bscImm][bscLane] = &A256Machine::tmpl<__VA_ARGS__, bscImm, bscLane>; \
+	variant[spec[code]][bscLane][bscFull] = &A256Machine::tmpl<__VA_ARGS__, bscLane, bscFull>; \
+	variant[spec[code]][bscLane][bscImm] = &A256Machine::tmpl<__VA_ARGS__, bscLane, bscImm>; \
+	variant[spec[code]][bscLane][bscLane] = &A256Machine::tmpl<__VA_ARGS__, bscLane, bscLane>
+
 			REG(0x0000, stop, itOp1_bsc1_imm32);
 			REG(0x0001, setd, itOp1_m1_imm32);
 			REG(0x0002, mmovb, itOp2_imm32);
 			REG(0x0003, mswapb, itOp2_imm32);
 
-			REG(0x0004, shufb, itOp3_m1_bsc2);
+			REG3(0x0004, shufb, itOp3_m1_bsc2, shufb_, u8);
 			REG(0x0005, shufbx, itOp6);
 			REG(0x0006, jrnz, itOp1_bsc1_imm32);
 			REG(0x0007, jrz, itOp1_bsc1_imm32);
 
-			REG(0x0008, cmovb, itOp3_m1_bsc2);
-			REG(0x0009, cmovw, itOp3_m1_bsc2);
-			REG(0x000a, cmovd, itOp3_m1_bsc2);
-			REG(0x000b, cmovq, itOp3_m1_bsc2);
+			REG3(0x0008, cmovb, itOp3_m1_bsc2, cmov_, s8);
+			REG3(0x0009, cmovw, itOp3_m1_bsc2, cmov_, s16);
+			REG3(0x000a, cmovd, itOp3_m1_bsc2, cmov_, s32);
+			REG3(0x000b, cmovq, itOp3_m1_bsc2, cmov_, s64);
 
-			REG(0x000c, cmovzb, itOp3_m1_bsc2);
-			REG(0x000d, cmovzw, itOp3_m1_bsc2);
-			REG(0x000e, cmovzd, itOp3_m1_bsc2);
-			REG(0x000f, cmovzq, itOp3_m1_bsc2);
+			REG3(0x000c, cmovzb, itOp3_m1_bsc2, cmovz_, s8);
+			REG3(0x000d, cmovzw, itOp3_m1_bsc2, cmovz_, s16);
+			REG3(0x000e, cmovzd, itOp3_m1_bsc2, cmovz_, s32);
+			REG3(0x000f, cmovzq, itOp3_m1_bsc2, cmovz_, s64);
 			
-			REG(0x0010, addfs, itOp3_m1_bsc2);
-			REG(0x0011, addfd, itOp3_m1_bsc2);
+			REG3(0x0010, addfs, itOp3_m1_bsc2, add_, f32);
+			REG3(0x0011, addfd, itOp3_m1_bsc2, add_, f64);
 			// 0x0012
 			// 0x0013
-			REG(0x0014, addb, itOp3_m1_bsc2);
-			REG(0x0015, addw, itOp3_m1_bsc2);
-			REG(0x0016, addd, itOp3_m1_bsc2);
-			REG(0x0017, addq, itOp3_m1_bsc2);
+			REG3(0x0014, addb, itOp3_m1_bsc2, add_, s8);
+			REG3(0x0015, addw, itOp3_m1_bsc2, add_, s16);
+			REG3(0x0016, addd, itOp3_m1_bsc2, add_, s32);
+			REG3(0x0017, addq, itOp3_m1_bsc2, add_, s64);
 
 			REG(0x0018, addfsi, itOp1_m1_imm32);
 			REG(0x0019, addfdi, itOp1_m1_imm32);
@@ -2105,42 +2346,42 @@ struct A256Machine
 			REG(0x001e, addqin, itOp1_m1_imm32n);
 			REG(0x001f, addr, itOp1_m1_imm32);
 
-			REG(0x0020, subfs, itOp3_m1_bsc2);
-			REG(0x0021, subfd, itOp3_m1_bsc2);
+			REG3(0x0020, subfs, itOp3_m1_bsc2, sub_, f32);
+			REG3(0x0021, subfd, itOp3_m1_bsc2, sub_, f64);
 			// 0x0022
 			// 0x0023
-			REG(0x0024, subb, itOp3_m1_bsc2);
-			REG(0x0025, subw, itOp3_m1_bsc2);
-			REG(0x0026, subd, itOp3_m1_bsc2);
-			REG(0x0027, subq, itOp3_m1_bsc2);
+			REG3(0x0024, subb, itOp3_m1_bsc2, sub_, s8);
+			REG3(0x0025, subw, itOp3_m1_bsc2, sub_, s16);
+			REG3(0x0026, subd, itOp3_m1_bsc2, sub_, s32);
+			REG3(0x0027, subq, itOp3_m1_bsc2, sub_, s64);
 
 			// 0x0028
 			// 0x0029
 			// 0x002a
 			// 0x002b
-			REG(0x002c, caddb, itOp3_m1_bsc2);
-			REG(0x002d, caddw, itOp3_m1_bsc2);
-			REG(0x002e, caddd, itOp3_m1_bsc2);
-			REG(0x002f, caddq, itOp3_m1_bsc2);
+			REG3(0x002c, caddb, itOp3_m1_bsc2, cadd_, s8, u8);
+			REG3(0x002d, caddw, itOp3_m1_bsc2, cadd_, s16, u16);
+			REG3(0x002e, caddd, itOp3_m1_bsc2, cadd_, s32, u32);
+			REG3(0x002f, caddq, itOp3_m1_bsc2, cadd_, s64, u64);
 
-			REG(0x0030, mulfs, itOp3_m1_bsc2);
-			REG(0x0031, mulfd, itOp3_m1_bsc2);
+			REG3(0x0030, mulfs, itOp3_m1_bsc2, mul_, f32);
+			REG3(0x0031, mulfd, itOp3_m1_bsc2, mul_, f64);
 			// 0x0032
 			// 0x0033
-			REG(0x0034, mulb, itOp3_m1_bsc2);
-			REG(0x0035, mulw, itOp3_m1_bsc2);
-			REG(0x0036, muld, itOp3_m1_bsc2);
-			REG(0x0037, mulq, itOp3_m1_bsc2);
+			REG3(0x0034, mulb, itOp3_m1_bsc2, mul_, s8);
+			REG3(0x0035, mulw, itOp3_m1_bsc2, mul_, s16);
+			REG3(0x0036, muld, itOp3_m1_bsc2, mul_, s32);
+			REG3(0x0037, mulq, itOp3_m1_bsc2, mul_, s64);
 
-			REG(0x0038, mulhub, itOp3_m1_bsc2);
-			REG(0x0039, mulhuw, itOp3_m1_bsc2);
-			REG(0x003a, mulhud, itOp3_m1_bsc2);
-			REG(0x003b, mulhuq, itOp3_m1_bsc2);
+			REG3(0x0038, mulhub, itOp3_m1_bsc2, mulh_, u8);
+			REG3(0x0039, mulhuw, itOp3_m1_bsc2, mulh_, u16);
+			REG3(0x003a, mulhud, itOp3_m1_bsc2, mulh_, u32);
+			REG3(0x003b, mulhuq, itOp3_m1_bsc2, mulh_, u64);
 
-			REG(0x003c, mulhsb, itOp3_m1_bsc2);
-			REG(0x003d, mulhsw, itOp3_m1_bsc2);
-			REG(0x003e, mulhsd, itOp3_m1_bsc2);
-			REG(0x003f, mulhsq, itOp3_m1_bsc2);
+			REG3(0x003c, mulhsb, itOp3_m1_bsc2, mulh_, s8);
+			REG3(0x003d, mulhsw, itOp3_m1_bsc2, mulh_, s16);
+			REG3(0x003e, mulhsd, itOp3_m1_bsc2, mulh_, s32);
+			REG3(0x003f, mulhsq, itOp3_m1_bsc2, mulh_, s64);
 
 			REG(0x0040, mafs, itOp4_sign4);
 			REG(0x0041, mafd, itOp4_sign4);
@@ -2161,14 +2402,14 @@ struct A256Machine
 			REG(0x004e, mahsd, itOp4_sign4);
 			REG(0x004f, mahsq, itOp4_sign4);*/
 
-			REG(0x0050, andfs, itOp3_m1_bsc2);
-			REG(0x0051, andfd, itOp3_m1_bsc2);
+			REG3(0x0050, andfs, itOp3_m1_bsc2, and_, f32);
+			REG3(0x0051, andfd, itOp3_m1_bsc2, and_, f64);
 			// 0x0052
 			// 0x0053
-			REG(0x0054, andb, itOp3_m1_bsc2);
-			REG(0x0055, andw, itOp3_m1_bsc2);
-			REG(0x0056, andd, itOp3_m1_bsc2);
-			REG(0x0057, andq, itOp3_m1_bsc2);
+			REG3(0x0054, andb, itOp3_m1_bsc2, and_, s8);
+			REG3(0x0055, andw, itOp3_m1_bsc2, and_, s16);
+			REG3(0x0056, andd, itOp3_m1_bsc2, and_, s32);
+			REG3(0x0057, andq, itOp3_m1_bsc2, and_, s64);
 
 			REG(0x0058, call, itOp1_m1_imm32);
 			// 0x0059
@@ -2179,14 +2420,14 @@ struct A256Machine
 			// 0x005e
 			// 0x005f
 
-			REG(0x0060, orfs, itOp3_m1_bsc2);
-			REG(0x0061, orfd, itOp3_m1_bsc2);
+			REG3(0x0060, orfs, itOp3_m1_bsc2, or_, f32);
+			REG3(0x0061, orfd, itOp3_m1_bsc2, or_, f64);
 			// 0x0062
 			// 0x0063
-			REG(0x0064, orb, itOp3_m1_bsc2);
-			REG(0x0065, orw, itOp3_m1_bsc2);
-			REG(0x0066, ord, itOp3_m1_bsc2);
-			REG(0x0067, orq, itOp3_m1_bsc2);
+			REG3(0x0064, orb, itOp3_m1_bsc2, or_, s8);
+			REG3(0x0065, orw, itOp3_m1_bsc2, or_, s16);
+			REG3(0x0066, ord, itOp3_m1_bsc2, or_, s32);
+			REG3(0x0067, orq, itOp3_m1_bsc2, or_, s64);
 
 			REG(0x0068, ret, itOp1_m1_imm32);
 			// 0x0069
@@ -2197,14 +2438,14 @@ struct A256Machine
 			// 0x006e
 			// 0x006f
 
-			REG(0x0070, xorfs, itOp3_m1_bsc2);
-			REG(0x0071, xorfd, itOp3_m1_bsc2);
+			REG3(0x0070, xorfs, itOp3_m1_bsc2, xor_, f32);
+			REG3(0x0071, xorfd, itOp3_m1_bsc2, xor_, f64);
 			// 0x0072
 			// 0x0073
-			REG(0x0074, xorb, itOp3_m1_bsc2);
-			REG(0x0075, xorw, itOp3_m1_bsc2);
-			REG(0x0076, xord, itOp3_m1_bsc2);
-			REG(0x0077, xorq, itOp3_m1_bsc2);
+			REG3(0x0074, xorb, itOp3_m1_bsc2, xor_, s8);
+			REG3(0x0075, xorw, itOp3_m1_bsc2, xor_, s16);
+			REG3(0x0076, xord, itOp3_m1_bsc2, xor_, s32);
+			REG3(0x0077, xorq, itOp3_m1_bsc2, xor_, s64);
 
 			REG(0x0078, stfs, itOp3_bsc3);
 			REG(0x0079, stfd, itOp3_bsc3);
@@ -2233,14 +2474,14 @@ struct A256Machine
 			REG(0x008e, ldrd, itOp1_m1_imm32);
 			REG(0x008f, ldrq, itOp1_m1_imm32);
 			 
-			REG(0x0090, unpkfs, itOp3_m1_bsc2);
-			REG(0x0091, unpkfd, itOp3_m1_bsc2);
-			REG(0x0092, unpkdq, itOp3_m1_bsc2);
+			REG3(0x0090, unpkfs, itOp3_m1_bsc2, unpk_, u32, f32);
+			REG3(0x0091, unpkfd, itOp3_m1_bsc2, unpk_, u64, f64);
+			REG3(0x0092, unpkdq, itOp3_m1_bsc2, unpk_, u128, u64);
 			// 0x0093
-			REG(0x0094, unpkb, itOp3_m1_bsc2);
-			REG(0x0095, unpkw, itOp3_m1_bsc2);
-			REG(0x0096, unpkd, itOp3_m1_bsc2);
-			REG(0x0097, unpkq, itOp3_m1_bsc2);
+			REG3(0x0094, unpkb, itOp3_m1_bsc2, unpk_, u8, s8);
+			REG3(0x0095, unpkw, itOp3_m1_bsc2, unpk_, u16, s16);
+			REG3(0x0096, unpkd, itOp3_m1_bsc2, unpk_, u32, s32);
+			REG3(0x0097, unpkq, itOp3_m1_bsc2, unpk_, u64, s64);
 
 			REG(0x0098, strfs, itOp1_bsc1_imm32);
 			REG(0x0099, strfd, itOp1_bsc1_imm32);
@@ -2251,49 +2492,49 @@ struct A256Machine
 			REG(0x009e, strd, itOp1_bsc1_imm32);
 			REG(0x009f, strq, itOp1_bsc1_imm32);
 
-			REG(0x00a0, packlfs, itOp3_m1_bsc2);
-			REG(0x00a1, packlfd, itOp3_m1_bsc2);
-			REG(0x00a2, packldq, itOp3_m1_bsc2);
+			REG3(0x00a0, packlfs, itOp3_m1_bsc2, pack_, u32, f32, 0);
+			REG3(0x00a1, packlfd, itOp3_m1_bsc2, pack_, u64, f64, 0);
+			REG3(0x00a2, packldq, itOp3_m1_bsc2, pack_, u128, u64, 0);
 			// 0x00a3
-			REG(0x00a4, packlb, itOp3_m1_bsc2);
-			REG(0x00a5, packlw, itOp3_m1_bsc2);
-			REG(0x00a6, packld, itOp3_m1_bsc2);
-			REG(0x00a7, packlq, itOp3_m1_bsc2);
-
-			REG(0x00a8, packhfs, itOp3_m1_bsc2);
-			REG(0x00a9, packhfd, itOp3_m1_bsc2);
-			REG(0x00aa, packhdq, itOp3_m1_bsc2);
+			REG3(0x00a4, packlb, itOp3_m1_bsc2, pack_, u8, s8, 0);
+			REG3(0x00a5, packlw, itOp3_m1_bsc2, pack_, u16, s16, 0);
+			REG3(0x00a6, packld, itOp3_m1_bsc2, pack_, u32, s32, 0);
+			REG3(0x00a7, packlq, itOp3_m1_bsc2, pack_, u64, s64, 0);
+
+			REG3(0x00a8, packhfs, itOp3_m1_bsc2, pack_, u32, f32, 1);
+			REG3(0x00a9, packhfd, itOp3_m1_bsc2, pack_, u64, f64, 1);
+			REG3(0x00aa, packhdq, itOp3_m1_bsc2, pack_, u128, u64, 1);
 			// 0x00ab
-			REG(0x00ac, packhb, itOp3_m1_bsc2);
-			REG(0x00ad, packhw, itOp3_m1_bsc2);
-			REG(0x00ae, packhd, itOp3_m1_bsc2);
-			REG(0x00af, packhq, itOp3_m1_bsc2);
+			REG3(0x00ac, packhb, itOp3_m1_bsc2, pack_, u8, s8, 1);
+			REG3(0x00ad, packhw, itOp3_m1_bsc2, pack_, u16, s16, 1);
+			REG3(0x00ae, packhd, itOp3_m1_bsc2, pack_, u32, s32, 1);
+			REG3(0x00af, packhq, itOp3_m1_bsc2, pack_, u64, s64, 1);
 
-			REG(0x00b0, divfs, itOp3_m1_bsc2);
-			REG(0x00b1, divfd, itOp3_m1_bsc2);
+			REG3(0x00b0, divfs, itOp3_m1_bsc2, div_, f32);
+			REG3(0x00b1, divfd, itOp3_m1_bsc2, div_, f64);
 			// 0x00b2
 			// 0x00b3
-			REG(0x00b4, divsb, itOp3_m1_bsc2);
-			REG(0x00b5, divsw, itOp3_m1_bsc2);
-			REG(0x00b6, divsd, itOp3_m1_bsc2);
-			REG(0x00b7, divsq, itOp3_m1_bsc2);
+			REG3(0x00b4, divsb, itOp3_m1_bsc2, div_, s8);
+			REG3(0x00b5, divsw, itOp3_m1_bsc2, div_, s16);
+			REG3(0x00b6, divsd, itOp3_m1_bsc2, div_, s32);
+			REG3(0x00b7, divsq, itOp3_m1_bsc2, div_, s64);
 			// 0x00b8
 			// 0x00b9
 			// 0x00ba
 			// 0x00bb
-			REG(0x00bc, divub, itOp3_m1_bsc2);
-			REG(0x00bd, divuw, itOp3_m1_bsc2);
-			REG(0x00be, divud, itOp3_m1_bsc2);
-			REG(0x00bf, divuq, itOp3_m1_bsc2);
+			REG3(0x00bc, divub, itOp3_m1_bsc2, div_, u8);
+			REG3(0x00bd, divuw, itOp3_m1_bsc2, div_, u16);
+			REG3(0x00be, divud, itOp3_m1_bsc2, div_, u32);
+			REG3(0x00bf, divuq, itOp3_m1_bsc2, div_, u64);
 
-			REG(0x00c0, rlfs, itOp3_m1_bsc2);
-			REG(0x00c1, rlfd, itOp3_m1_bsc2);
+			REG3(0x00c0, rlfs, itOp3_m1_bsc2, rl_, f32, u32);
+			REG3(0x00c1, rlfd, itOp3_m1_bsc2, rl_, f64, u64);
 			REG(0x00c2, rldq, itOp3_m1_bsc2);
 			REG(0x00c3, rlqq, itOp3_m1_bsc2);
-			REG(0x00c4, rlb, itOp3_m1_bsc2);
-			REG(0x00c5, rlw, itOp3_m1_bsc2);
-			REG(0x00c6, rld, itOp3_m1_bsc2);
-			REG(0x00c7, rlq, itOp3_m1_bsc2);
+			REG3(0x00c4, rlb, itOp3_m1_bsc2, rl_, s8, u8);
+			REG3(0x00c5, rlw, itOp3_m1_bsc2, rl_, s16, u16);
+			REG3(0x00c6, rld, itOp3_m1_bsc2, rl_, s32, u32);
+			REG3(0x00c7, rlq, itOp3_m1_bsc2, rl_, s64, u64);
 
 			// 0x00c8
 			// 0x00c9
@@ -2304,14 +2545,14 @@ struct A256Machine
 			// 0x00ce
 			// 0x00cf
 
-			REG(0x00d0, sllfs, itOp3_m1_bsc2);
-			REG(0x00d1, sllfd, itOp3_m1_bsc2);
+			REG3(0x00d0, sllfs, itOp3_m1_bsc2, sll_, f32, u32);
+			REG3(0x00d1, sllfd, itOp3_m1_bsc2, sll_, f64, u64);
 			REG(0x00d2, slldq, itOp3_m1_bsc2);
 			REG(0x00d3, sllqq, itOp3_m1_bsc2);
-			REG(0x00d4, sllb, itOp3_m1_bsc2);
-			REG(0x00d5, sllw, itOp3_m1_bsc2);
-			REG(0x00d6, slld, itOp3_m1_bsc2);
-			REG(0x00d7, sllq, itOp3_m1_bsc2);
+			REG3(0x00d4, sllb, itOp3_m1_bsc2, sll_, s8, u8);
+			REG3(0x00d5, sllw, itOp3_m1_bsc2, sll_, s16, u16);
+			REG3(0x00d6, slld, itOp3_m1_bsc2, sll_, s32, u32);
+			REG3(0x00d7, sllq, itOp3_m1_bsc2, sll_, s64, u64);
 
 			// 0x00d8
 			// 0x00d9
@@ -2322,14 +2563,14 @@ struct A256Machine
 			// 0x00de
 			// 0x00df
 
-			REG(0x00e0, sarfs, itOp3_m1_bsc2);
-			REG(0x00e1, sarfd, itOp3_m1_bsc2);
+			REG3(0x00e0, sarfs, itOp3_m1_bsc2, sar_, f32, u32);
+			REG3(0x00e1, sarfd, itOp3_m1_bsc2, sar_, f64, u64);
 			REG(0x00e2, sardq, itOp3_m1_bsc2);
 			REG(0x00e3, sarqq, itOp3_m1_bsc2);
-			REG(0x00e4, sarb, itOp3_m1_bsc2);
-			REG(0x00e5, sarw, itOp3_m1_bsc2);
-			REG(0x00e6, sard, itOp3_m1_bsc2);
-			REG(0x00e7, sarq, itOp3_m1_bsc2);
+			REG3(0x00e4, sarb, itOp3_m1_bsc2, sar_, s8, u8);
+			REG3(0x00e5, sarw, itOp3_m1_bsc2, sar_, s16, u16);
+			REG3(0x00e6, sard, itOp3_m1_bsc2, sar_, s32, u32);
+			REG3(0x00e7, sarq, itOp3_m1_bsc2, sar_, s64, u64);
 
 			// 0x00e8
 			// 0x00e9
@@ -2340,14 +2581,14 @@ struct A256Machine
 			// 0x00ee
 			// 0x00ef
 
-			REG(0x00f0, slrfs, itOp3_m1_bsc2);
-			REG(0x00f1, slrfd, itOp3_m1_bsc2);
+			REG3(0x00f0, slrfs, itOp3_m1_bsc2, slr_, f32, u32);
+			REG3(0x00f1, slrfd, itOp3_m1_bsc2, slr_, f64, u64);
 			REG(0x00f2, slrdq, itOp3_m1_bsc2);
 			REG(0x00f3, slrqq, itOp3_m1_bsc2);
-			REG(0x00f4, slrb, itOp3_m1_bsc2);
-			REG(0x00f5, slrw, itOp3_m1_bsc2);
-			REG(0x00f6, slrd, itOp3_m1_bsc2);
-			REG(0x00f7, slrq, itOp3_m1_bsc2);
+			REG3(0x00f4, slrb, itOp3_m1_bsc2, slr_, s8, u8);
+			REG3(0x00f5, slrw, itOp3_m1_bsc2, slr_, s16, u16);
+			REG3(0x00f6, slrd, itOp3_m1_bsc2, slr_, s32, u32);
+			REG3(0x00f7, slrq, itOp3_m1_bsc2, slr_, s64, u64);
 
 			// 0x00f8
 			// 0x00f9
@@ -2358,119 +2599,170 @@ struct A256Machine
 			// 0x00fe
 			// 0x00ff
 
-			REG(0x0100, ceqfs, itOp3_m1_bsc2);
-			REG(0x0101, ceqfd, itOp3_m1_bsc2);
+			REG3(0x0100, ceqfs, itOp3_m1_bsc2, ceq_, f32);
+			REG3(0x0101, ceqfd, itOp3_m1_bsc2, ceq_, f64);
 			// 0x0102
 			// 0x0103
-			REG(0x0104, ceqb, itOp3_m1_bsc2);
-			REG(0x0105, ceqw, itOp3_m1_bsc2);
-			REG(0x0106, ceqd, itOp3_m1_bsc2);
-			REG(0x0107, ceqq, itOp3_m1_bsc2);
-
-			// 0x0108
-			// 0x0109
-			// 0x010a
-			// 0x010b
-			// 0x010c
-			// 0x010d
-			// 0x010e
-			// 0x010f
-
-			REG(0x0110, cgtfs, itOp3_m1_bsc2);
-			REG(0x0111, cgtfd, itOp3_m1_bsc2);
+			REG3(0x0104, ceqb, itOp3_m1_bsc2, ceq_, s8);
+			REG3(0x0105, ceqw, itOp3_m1_bsc2, ceq_, s16);
+			REG3(0x0106, ceqd, itOp3_m1_bsc2, ceq_, s32);
+			REG3(0x0107, ceqq, itOp3_m1_bsc2, ceq_, s64);
+
+			REG(0x0108, loopd, itOp1_m1_imm32);
+			REG(0x0109, loopq, itOp1_m1_imm32);
+			REG(0x010a, jrall, itOp1_bsc1_imm32);
+			REG(0x010b, jrnall, itOp1_bsc1_imm32);
+			REG3(0x010c, jreqd, itOp2_bsc2_imm16, jreq_, u32);
+			REG3(0x010d, jrned, itOp2_bsc2_imm16, jrne_, u32);
+			REG3(0x010e, jrltsd, itOp2_bsc2_imm16, jrlt_, s32);
+			REG3(0x010f, jrltud, itOp2_bsc2_imm16, jrlt_, u32);
+
+			REG3(0x0110, cgtfs, itOp3_m1_bsc2, cgt_, f32);
+			REG3(0x0111, cgtfd, itOp3_m1_bsc2, cgt_, f64);
 			// 0x0112
 			// 0x0113
-			REG(0x0114, cgtsb, itOp3_m1_bsc2);
-			REG(0x0115, cgtsw, itOp3_m1_bsc2);
-			REG(0x0116, cgtsd, itOp3_m1_bsc2);
-			REG(0x0117, cgtsq, itOp3_m1_bsc2);
+			REG3(0x0114, cgtsb, itOp3_m1_bsc2, cgt_, s8);
+			REG3(0x0115, cgtsw, itOp3_m1_bsc2, cgt_, s16);
+			REG3(0x0116, cgtsd, itOp3_m1_bsc2, cgt_, s32);
+			REG3(0x0117, cgtsq, itOp3_m1_bsc2, cgt_, s64);
 			// 0x0118
 			// 0x0119
 			// 0x011a
 			// 0x011b
-			REG(0x011c, cgtub, itOp3_m1_bsc2);
-			REG(0x011d, cgtuw, itOp3_m1_bsc2);
-			REG(0x011e, cgtud, itOp3_m1_bsc2);
-			REG(0x011f, cgtuq, itOp3_m1_bsc2);
+			REG3(0x011c, cgtub, itOp3_m1_bsc2, cgt_, u8);
+			REG3(0x011d, cgtuw, itOp3_m1_bsc2, cgt_, u16);
+			REG3(0x011e, cgtud, itOp3_m1_bsc2, cgt_, u32);
+			REG3(0x011f, cgtuq, itOp3_m1_bsc2, cgt_, u64);
 
-			REG(0x0120, minfs, itOp3_m1_bsc2);
-			REG(0x0121, minfd, itOp3_m1_bsc2);
+			REG3(0x0120, minfs, itOp3_m1_bsc2, min_, f32);
+			REG3(0x0121, minfd, itOp3_m1_bsc2, min_, f64);
 			// 0x0122
 			// 0x0123
-			REG(0x0124, minsb, itOp3_m1_bsc2);
-			REG(0x0125, minsw, itOp3_m1_bsc2);
-			REG(0x0126, minsd, itOp3_m1_bsc2);
-			REG(0x0127, minsq, itOp3_m1_bsc2);
+			REG3(0x0124, minsb, itOp3_m1_bsc2, min_, s8);
+			REG3(0x0125, minsw, itOp3_m1_bsc2, min_, s16);
+			REG3(0x0126, minsd, itOp3_m1_bsc2, min_, s32);
+			REG3(0x0127, minsq, itOp3_m1_bsc2, min_, s64);
 			// 0x0128
 			// 0x0129
 			// 0x012a
 			// 0x012b
-			REG(0x012c, minub, itOp3_m1_bsc2);
-			REG(0x012d, minuw, itOp3_m1_bsc2);
-			REG(0x012e, minud, itOp3_m1_bsc2);
-			REG(0x012f, minuq, itOp3_m1_bsc2);
+			REG3(0x012c, minub, itOp3_m1_bsc2, min_, u8);
+			REG3(0x012d, minuw, itOp3_m1_bsc2, min_, u16);
+			REG3(0x012e, minud, itOp3_m1_bsc2, min_, u32);
+			REG3(0x012f, minuq, itOp3_m1_bsc2, min_, u64);
 
-			REG(0x0130, maxfs, itOp3_m1_bsc2);
-			REG(0x0131, maxfd, itOp3_m1_bsc2);
+			REG3(0x0130, maxfs, itOp3_m1_bsc2, max_, f32);
+			REG3(0x0131, maxfd, itOp3_m1_bsc2, max_, f64);
 			// 0x0132
 			// 0x0133
-			REG(0x0134, maxsb, itOp3_m1_bsc2);
-			REG(0x0135, maxsw, itOp3_m1_bsc2);
-			REG(0x0136, maxsd, itOp3_m1_bsc2);
-			REG(0x0137, maxsq, itOp3_m1_bsc2);
+			REG3(0x0134, maxsb, itOp3_m1_bsc2, max_, s8);
+			REG3(0x0135, maxsw, itOp3_m1_bsc2, max_, s16);
+			REG3(0x0136, maxsd, itOp3_m1_bsc2, max_, s32);
+			REG3(0x0137, maxsq, itOp3_m1_bsc2, max_, s64);
 			// 0x0138
 			// 0x0139
 			// 0x013a
 			// 0x013b
-			REG(0x013c, maxub, itOp3_m1_bsc2);
-			REG(0x013d, maxuw, itOp3_m1_bsc2);
-			REG(0x013e, maxud, itOp3_m1_bsc2);
-			REG(0x013f, maxuq, itOp3_m1_bsc2);
+			REG3(0x013c, maxub, itOp3_m1_bsc2, max_, u8);
+			REG3(0x013d, maxuw, itOp3_m1_bsc2, max_, u16);
+			REG3(0x013e, maxud, itOp3_m1_bsc2, max_, u32);
+			REG3(0x013f, maxuq, itOp3_m1_bsc2, max_, u64);
 
-			REG(0x0140, haddfs, itOp3_m1_bsc2);
-			REG(0x0141, haddfd, itOp3_m1_bsc2);
+			REG3(0x0140, haddfs, itOp3_m1_bsc2, hadd_, f32);
+			REG3(0x0141, haddfd, itOp3_m1_bsc2, hadd_, f64);
 			// 0x0142
 			// 0x0143
-			REG(0x0144, haddb, itOp3_m1_bsc2);
-			REG(0x0145, haddw, itOp3_m1_bsc2);
-			REG(0x0146, haddd, itOp3_m1_bsc2);
-			REG(0x0147, haddq, itOp3_m1_bsc2);
-
-			// 0x0148
-			// 0x0149
-			// 0x014a
-			// 0x014b
-			// 0x014c
-			// 0x014d
-			// 0x014e
-			// 0x014f
-
-			REG(0x0150, hsubfs, itOp3_m1_bsc2);
-			REG(0x0151, hsubfd, itOp3_m1_bsc2);
+			REG3(0x0144, haddb, itOp3_m1_bsc2, hadd_, s8);
+			REG3(0x0145, haddw, itOp3_m1_bsc2, hadd_, s16);
+			REG3(0x0146, haddd, itOp3_m1_bsc2, hadd_, s32);
+			REG3(0x0147, haddq, itOp3_m1_bsc2, hadd_, s64);
+
+			REG(0x0148, gatherfs, itOp3_m1_bsc2);
+			REG(0x0149, gatherfd, itOp3_m1_bsc2);
+			REG(0x014a, gatherd, itOp3_m1_bsc2);
+			REG(0x014b, gatherq, itOp3_m1_bsc2);
+			REG(0x014c, scatterfs, itOp3_m1_bsc2);
+			REG(0x014d, scatterfd, itOp3_m1_bsc2);
+			REG(0x014e, scatterd, itOp3_m1_bsc2);
+			REG(0x014f, scatterq, itOp3_m1_bsc2);
+
+			REG3(0x0150, hsubfs, itOp3_m1_bsc2, hsub_, f32);
+			REG3(0x0151, hsubfd, itOp3_m1_bsc2, hsub_, f64);
 			// 0x0152
 			// 0x0153
-			REG(0x0154, hsubb, itOp3_m1_bsc2);
-			REG(0x0155, hsubw, itOp3_m1_bsc2);
-			REG(0x0156, hsubd, itOp3_m1_bsc2);
-			REG(0x0157, hsubq, itOp3_m1_bsc2);
-
-			// 0x0158
-			// 0x0159
-			// 0x015a
-			// 0x015b
+			REG3(0x0154, hsubb, itOp3_m1_bsc2, hsub_, s8);
+			REG3(0x0155, hsubw, itOp3_m1_bsc2, hsub_, s16);
+			REG3(0x0156, hsubd, itOp3_m1_bsc2, hsub_, s32);
+			REG3(0x0157, hsubq, itOp3_m1_bsc2, hsub_, s64);
+
+			REG(0x0158, blkcpy, itOp3_bsc3);
+			REG(0x0159, blkmov, itOp3_bsc3);
+			REG(0x015a, blkset, itOp3_bsc3);
+			REG(0x015b, blkcmp, itOp3_m1_bsc2);
 			// 0x015c
 			// 0x015d
 			// 0x015e
 			// 0x015f
 
+#define FUSE_ARG(...) __VA_ARGS__
+
+#define FUSED(code, n) \
+	if (func[code] != nullptr) printf("Initialization warning: opcode 0x%x (%s) overwritten.\n", code, name[code]); \
+	name[code] = n; \
+	max_num = std::max<u32>(code, max_num)
+
+#define FUSE2(code, n, f1, v1, f2, v2) \
+	FUSED(code, n); \
+	func[code] = &A256Machine::fuse2_<&A256Machine::FUSE_ARG v1, &A256Machine::FUSE_ARG v2>; \
+	fusions.push_back(A256Fusion({ code, 2, { &A256Machine::FUSE_ARG v1, &A256Machine::FUSE_ARG v2, nullptr }, { &A256Machine::f1, &A256Machine::f2, nullptr } }))
+
+#define FUSE3(code, n, f1, v1, f2, v2, f3, v3) \
+	FUSED(code, n); \
+	func[code] = &A256Machine::fuse3_<&A256Machine::FUSE_ARG v1, &A256Machine::FUSE_ARG v2, &A256Machine::FUSE_ARG v3>; \
+	fusions.push_back(A256Fusion({ code, 3, { &A256Machine::FUSE_ARG v1, &A256Machine::FUSE_ARG v2, &A256Machine::FUSE_ARG v3 }, { &A256Machine::f1, &A256Machine::f2, &A256Machine::f3 } }))
+
+#include "A256Fused.h"
+
+#undef FUSE3
+#undef FUSE2
+#undef FUSED
+#undef FUSE_ARG
+#undef REG3
 #undef REG
+
+			// build indices, the lowest opcode wins if registered twice
+			for (u32 i = 0; i <= max_num; i++)
+			{
+				if (func[i] != nullptr)
+				{
+					opcodes.emplace(name[i], (u16)i);
+					handlers.emplace(key(func[i]), (u16)i);
+				}
+			}
+
+			// superinstructions take operand types of their first part
+			for (auto& f : fusions)
+			{
+				for (u32 k = 0; k < f.length; k++)
+				{
+					f.seq[k] = find(f.generic[k]);
+				}
+				type[f.code] = type[f.seq[0]];
+			}
+			std::stable_sort(fusions.begin(), fusions.end(), [](const A256Fusion& a, const A256Fusion& b){ return a.length > b.length; });
 		}
 
 		const u16 find(void (A256Machine::*f)()) const
 		{
+			const auto found = handlers.find(key(f));
+			if (found != handlers.end())
+			{
+				return found->second;
+			}
+			// equal pointers may differ in padding bytes (MSVC general representation for incomplete classes), compare them
 			for (u32 i = 0; i <= max_num; i++)
 			{
-				if (func[i] == f)
+				if (func[i] != nullptr && func[i] == f)
 				{
 					return (u16)i;
 				}
@@ -2478,9 +2770,44 @@ struct A256Machine
 			throw fmt::format(__FUNCTION__"(): unregistered instruction.");
 		}
 
-	} instr;
+	};
+
+	const A256InstrTable& instr; // shared, so machines are small and cheap to create (see table())
+
+	static const A256InstrTable& table() // built by the first machine and never freed
+	{
+		static std::once_flag once; // constant-initialized, function-local statics are not thread-safe in VS2013
+		static const A256InstrTable* shared = nullptr;
+		std::call_once(once, []{ shared = new A256InstrTable; });
+		return *shared;
+	}
+
+	struct A256Decoded // pre-decoded instruction
+	{
+		void (A256Machine::*func)(); // handler
+		A256Cmd args; // whole instruction, accessed in place as op
+	};
+
+	struct A256Threaded // pre-decoded program (see decode() and run())
+	{
+		const A256Cmd* base; // original program, $NP points into it
+		size_t size;
+		std::vector<A256Decoded> code; // one entry per A256Cmd
+	};
+
+	struct A256Symbol // label or const reported by compile()
+	{
+		std::string name; // with '@' or '#' prefix
+		u64 value; // instruction index of label or value of const
+	};
+
+	struct A256Link // resolved reference to symbol
+	{
+		u64 pos; // instruction index
+		u64 symbol; // index in symbols
+	};
 
-	std::vector<A256Cmd> compile(const std::string& text)
+	std::vector<A256Cmd> compile(const std::string& text, std::vector<A256Symbol>* symbols = nullptr, std::vector<A256Link>* links = nullptr, std::vector<u64>* lines = nullptr)
 	{
 		struct A256Label
 		{
@@ -2501,6 +2828,7 @@ struct A256Machine
 			size_t rpos;
 			size_t text_pos;
 			std::string target;
+			u32 size; // 4: op1i.imm, 2: op2j.imm
 		};
 
 		struct A256Compiler
@@ -2509,8 +2837,8 @@ struct A256Machine
 			const size_t len;
 			size_t pos;
 			std::vector<A256Cmd> output;
-			std::vector<A256Label> labels;
-			std::vector<A256Const> consts;
+			std::unordered_map<std::string, A256Label> labels;
+			std::unordered_map<std::string, A256Const> consts;
 			std::vector<A256Reloc> relocs;
 
 			A256Compiler(const std::string& text)
@@ -3135,25 +3463,65 @@ struct A256Machine
 							pos += 6;
 							return r | 0xf100;
 						}
-						else if (pos + 4 < len && !strncmp(&text[pos], "getub", 5))
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfsr", 6))
 						{
-							pos += 5;
-							return r | 0xf200;
+							pos += 6;
+							return r | 0x5000;
 						}
-						else if (pos + 4 < len && !strncmp(&text[pos], "getsb", 5))
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfst", 6))
 						{
-							pos += 5;
-							return r | 0xf300;
+							pos += 6;
+							return r | 0x5100;
 						}
-						else if (pos + 4 < len && !strncmp(&text[pos], "getuw", 5))
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfsf", 6))
 						{
-							pos += 5;
-							return r | 0xf400;
+							pos += 6;
+							return r | 0x5200;
 						}
-						else if (pos + 4 < len && !strncmp(&text[pos], "getsw", 5))
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfsc", 6))
 						{
-							pos += 5;
-							return r | 0xf500;
+							pos += 6;
+							return r | 0x5300;
+						}
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfdr", 6))
+						{
+							pos += 6;
+							return r | 0x5400;
+						}
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfdt", 6))
+						{
+							pos += 6;
+							return r | 0x5500;
+						}
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfdf", 6))
+						{
+							pos += 6;
+							return r | 0x5600;
+						}
+						else if (pos + 5 < len && !strncmp(&text[pos], "getfdc", 6))
+						{
+							pos += 6;
+							return r | 0x5700;
+						}
+						else if (pos + 4 < len && !strncmp(&text[pos], "getub", 5))
+						{
+							pos += 5;
+							return r | 0xf200;
+						}
+						else if (pos + 4 < len && !strncmp(&text[pos], "getsb", 5))
+						{
+							pos += 5;
+							return r | 0xf300;
+						}
+						else if (pos + 4 < len && !strncmp(&text[pos], "getuw", 5))
+						{
+							pos += 5;
+							return r | 0xf400;
+						}
+						else if (pos + 4 < len && !strncmp(&text[pos], "getsw", 5))
+						{
+							pos += 5;
+							return r | 0xf500;
 						}
 						else if (pos + 4 < len && !strncmp(&text[pos], "getud", 5))
 						{
@@ -3278,6 +3646,7 @@ struct A256Machine
 					r1.rpos = output.size();
 					r1.target = std::string(&text[start], pos - start);
 					r1.text_pos = start;
+					r1.size = 4;
 					relocs.push_back(r1);
 					return 0;
 				}
@@ -3304,6 +3673,23 @@ struct A256Machine
 				}
 			}
 
+			s16 read_rel16() // as read_imm32(), relocation writes op2j.imm
+			{
+				const size_t count = relocs.size();
+				const size_t start = pos;
+				const u32 num = read_imm32();
+				if (relocs.size() != count)
+				{
+					relocs.back().size = 2;
+				}
+				else if ((s32)num != (s16)num)
+				{
+					printf(__FUNCTION__"(): immediate too big (-0x8000..0x7fff expected).\n");
+					throw start;
+				}
+				return (s16)num;
+			}
+
 			u64 read_imm64()
 			{
 				if (pos >= len)
@@ -3388,12 +3774,20 @@ struct A256Machine
 		size_t& pos = compiler.pos;
 		const size_t& len = compiler.len;
 		std::vector<A256Cmd>& output = compiler.output;
-		std::vector<A256Label>& labels = compiler.labels;
+		std::unordered_map<std::string, A256Label>& labels = compiler.labels;
 		std::vector<A256Reloc>& relocs = compiler.relocs;
-		std::vector<A256Const>& consts = compiler.consts;
+		std::unordered_map<std::string, A256Const>& consts = compiler.consts;
+		std::vector<size_t> starts; // text position of each instruction (for lines)
+		size_t stmt = 0; // start of current statement
 
 		while (pos < len)
 		{
+			if (lines)
+			{
+				starts.resize(output.size(), stmt); // generated by previous statement
+				stmt = pos;
+			}
+
 			// filter comments or end-of-line
 			switch (text[pos])
 			{
@@ -3434,8 +3828,11 @@ struct A256Machine
 				l1.lpos = output.size();
 				l1.name = std::string(&text[start], pos - start);
 				l1.text_pos = start;
-				// TODO: check existing labels
-				labels.push_back(l1);
+				if (!labels.emplace(l1.name, l1).second)
+				{
+					printf(__FUNCTION__"(): label '%s' already defined.\n", l1.name.c_str());
+					throw start;
+				}
 				pos++;
 				continue;
 			}
@@ -3462,8 +3859,11 @@ struct A256Machine
 				compiler.read_space();
 				c1.value = compiler.read_imm32(false);
 				c1.text_pos = start;
-				// TODO: check existing consts
-				consts.push_back(c1);
+				if (!consts.emplace(c1.name, c1).second)
+				{
+					printf(__FUNCTION__"(): const '%s' already defined.\n", c1.name.c_str());
+					throw start;
+				}
 				continue;
 			}
 			case 'j':
@@ -3536,24 +3936,20 @@ struct A256Machine
 			default: break;
 			}
 
-			// find opcode
-			u32 opcode;
-			for (opcode = 0; opcode <= instr.max_num; opcode++)
+			// find opcode (mnemonics consist of 'a' .. 'z' only)
+			size_t op_len = 0;
+			while (pos + op_len < len && text[pos + op_len] >= 'a' && text[pos + op_len] <= 'z')
 			{
-				if (!instr.name[opcode]) continue;
-				const size_t op_len = strlen(instr.name[opcode]);
-				if (!strncmp(&text[pos], instr.name[opcode], op_len))
-				{
-					if (pos + op_len < len && text[pos + op_len] >= 'a' && text[pos + op_len] <= 'z') continue;
-					pos += op_len;
-					break;
-				}
+				op_len++;
 			}
-			if (opcode > instr.max_num)
+			const auto found = instr.opcodes.find(std::string(&text[pos], op_len));
+			if (found == instr.opcodes.end())
 			{
 				printf(__FUNCTION__"(): unknown instruction found.\n");
 				throw pos;
 			}
+			const u32 opcode = found->second;
+			pos += op_len;
 
 			compiler.read_space();
 
@@ -3635,6 +4031,15 @@ struct A256Machine
 				cmd.op1i.imm = compiler.read_imm32();
 				break;
 			}
+			case itOp2_bsc2_imm16:
+			{
+				cmd.raww[1] = compiler.read_rbsc1();
+				compiler.read_comma();
+				cmd.raww[2] = compiler.read_rbsc1();
+				compiler.read_comma();
+				cmd.op2j.imm = compiler.read_rel16();
+				break;
+			}
 			case itOp3_m1_bsc2:
 			{
 				cmd.raww[0] = compiler.read_rmask1();
@@ -3720,23 +4125,44 @@ struct A256Machine
 		}
 		output.push_back(A256Cmd({ instr.find(&A256Machine::stop), 0, 0, 0xef, 0xbe, 0xad, 0xde }));
 
+		if (lines) // convert text positions to line numbers
+		{
+			starts.resize(output.size() - 1, stmt);
+			starts.push_back(len);
+			size_t line = 1;
+			size_t i = 0;
+			for (size_t p : starts)
+			{
+				for (; i < p; i++)
+				{
+					if (text[i] == '\n') line++;
+				}
+				lines->push_back(line);
+			}
+		}
+
 		// relocations:
 		for (auto& r : relocs)
 		{
 			if (r.target[0] == '@')
 			{
-				A256Label* found = nullptr;
-				for (auto& l : labels)
+				const auto found = labels.find(r.target);
+				if (found != labels.end())
 				{
-					if (l.name == r.target)
+					const s64 offset = ((s64)found->second.lpos - (s64)r.rpos - 1) * (s64)sizeof(A256Cmd);
+					if (r.size == 2)
 					{
-						found = &l;
-						break;
+						if (offset != (s16)offset)
+						{
+							printf(__FUNCTION__"(): label '%s' too far (imm16).\n", r.target.c_str());
+							throw r.text_pos;
+						}
+						output[r.rpos].op2j.imm = (s16)offset;
+					}
+					else
+					{
+						output[r.rpos].op1i.imm = (u32)offset;
 					}
-				}
-				if (found)
-				{
-					output[r.rpos].op1i.imm = (u32)((found->lpos - r.rpos - 1) * sizeof(A256Cmd));
 				}
 				else
 				{
@@ -3746,18 +4172,22 @@ struct A256Machine
 			}
 			else if (r.target[0] == '#')
 			{
-				A256Const* found = nullptr;
-				for (auto& c : consts)
+				const auto found = consts.find(r.target);
+				if (found != consts.end())
 				{
-					if (c.name == r.target)
+					if (r.size == 2)
 					{
-						found = &c;
-						break;
+						if ((s32)found->second.value != (s16)found->second.value)
+						{
+							printf(__FUNCTION__"(): const '%s' too big (imm16).\n", r.target.c_str());
+							throw r.text_pos;
+						}
+						output[r.rpos].op2j.imm = (s16)found->second.value;
+					}
+					else
+					{
+						output[r.rpos].op1i.imm = found->second.value;
 					}
-				}
-				if (found)
-				{
-					output[r.rpos].op1i.imm = found->value;
 				}
 				else
 				{
@@ -3771,16 +4201,590 @@ struct A256Machine
 				throw r.text_pos;
 			}
 		}
+
+		// symbol table (labels in program order, then consts by name) and references to it
+		if (symbols)
+		{
+			std::unordered_map<std::string, u64> index;
+			for (auto& l : labels)
+			{
+				symbols->push_back(A256Symbol({ l.first, l.second.lpos }));
+			}
+			for (auto& c : consts)
+			{
+				symbols->push_back(A256Symbol({ c.first, c.second.value }));
+			}
+			std::sort(symbols->begin(), symbols->end(), [](const A256Symbol& a, const A256Symbol& b)
+			{
+				if (a.name[0] != b.name[0]) return a.name[0] == '@';
+				if (a.name[0] == '@' && a.value != b.value) return a.value < b.value;
+				return a.name < b.name;
+			});
+			for (u64 i = 0; i < symbols->size(); i++)
+			{
+				index[(*symbols)[i].name] = i;
+			}
+			if (links)
+			{
+				for (auto& r : relocs)
+				{
+					links->push_back(A256Link({ r.rpos, index[r.target] }));
+				}
+			}
+		}
 		return output;
 	}
 
+	std::vector<A256Cmd> optimize(const std::vector<A256Cmd>& program, std::vector<A256Symbol>* symbols = nullptr, std::vector<A256Link>* links = nullptr, std::vector<u64>* lines = nullptr) const
+	{
+		/*
+		peephole pass over compile() output (symbols, links and lines are updated in place):
+		1) code is what the first instruction reaches through fall-through, jumps and calls,
+		   anything else (data, code entered through computed addresses) is kept as is and must not jump into code
+		2) stop 0, ret and unconditional jumps (j: jrnz $00 with full selector) end the flow, writes to $00 are not optimized
+		3) jumps to unconditional jumps are redirected to the final target
+		4) jumps to the next instruction, mmovb without effect and adddi 0 are removed
+		5) setd followed by adddi with the same register and mask are folded, so are mmovb with the same registers
+		6) setd, adddi, mmovb and three-register arithmetic whose result dwords are overwritten in the same straight run
+		   before any read are removed
+		7) relative immediates (jumps, call, addr, ldr*, str*) of code are rewritten for the removed instructions
+		8) sequences registered in A256Fused.h get the opcode of their superinstruction (see fuse2_())
+		*/
+		std::vector<u8> kind(instr.max_num + 1, okOther);
+#define OPT(f, k) kind[instr.find(&A256Machine::f)] = k
+		OPT(addfs, okOp3); OPT(addfd, okOp3); OPT(addb, okOp3); OPT(addw, okOp3); OPT(addd, okOp3); OPT(addq, okOp3);
+		OPT(subfs, okOp3); OPT(subfd, okOp3); OPT(subb, okOp3); OPT(subw, okOp3); OPT(subd, okOp3); OPT(subq, okOp3);
+		OPT(mulfs, okOp3); OPT(mulfd, okOp3); OPT(mulb, okOp3); OPT(mulw, okOp3); OPT(muld, okOp3); OPT(mulq, okOp3);
+		OPT(mulhub, okOp3); OPT(mulhuw, okOp3); OPT(mulhud, okOp3); OPT(mulhuq, okOp3);
+		OPT(mulhsb, okOp3); OPT(mulhsw, okOp3); OPT(mulhsd, okOp3); OPT(mulhsq, okOp3);
+		OPT(andfs, okOp3); OPT(andfd, okOp3); OPT(andb, okOp3); OPT(andw, okOp3); OPT(andd, okOp3); OPT(andq, okOp3);
+		OPT(orfs, okOp3); OPT(orfd, okOp3); OPT(orb, okOp3); OPT(orw, okOp3); OPT(ord, okOp3); OPT(orq, okOp3);
+		OPT(xorfs, okOp3); OPT(xorfd, okOp3); OPT(xorb, okOp3); OPT(xorw, okOp3); OPT(xord, okOp3); OPT(xorq, okOp3);
+		OPT(setd, okSet);
+		OPT(adddi, okAddImm);
+		OPT(mmovb, okMoveBytes);
+		OPT(jrnz, okJump); OPT(jrz, okJump); OPT(jrall, okJump); OPT(jrnall, okJump);
+		OPT(jreqd, okJump16); OPT(jrned, okJump16); OPT(jrltsd, okJump16); OPT(jrltud, okJump16);
+		OPT(loopd, okLoop); OPT(loopq, okLoop);
+		OPT(call, okCall);
+		OPT(ret, okRet);
+		OPT(addr, okData); OPT(ldr, okData); OPT(ldrdq, okData); OPT(ldrb, okData); OPT(ldrw, okData); OPT(ldrd, okData); OPT(ldrq, okData);
+		OPT(strm, okData); OPT(strfs, okData); OPT(strfd, okData); OPT(strdq, okData); OPT(strb, okData); OPT(strw, okData); OPT(strd, okData); OPT(strq, okData);
+#undef OPT
+
+		std::vector<A256Cmd> code(program);
+		const size_t count = code.size();
+		for (const auto& f : instr.fusions)
+		{
+			for (auto& c : code)
+			{
+				if (c.cmd == f.code)
+				{
+					c.cmd = f.seq[0]; // already optimized input, fused again at the end (unreached words are copied from program)
+				}
+			}
+		}
+		const s64 size = (s64)(count * sizeof(A256Cmd));
+		const u16 jrnz_cmd = instr.find(&A256Machine::jrnz);
+		const u16 stop_cmd = instr.find(&A256Machine::stop);
+
+		auto type = [&](size_t i) -> u32
+		{
+			const A256Cmd& c = code[i];
+			const u32 k = c.cmd <= instr.max_num ? kind[c.cmd] : okOther;
+			if ((k == okOp3 || k == okSet || k == okAddImm || k == okMoveBytes) && c.op3.r == 0)
+			{
+				return okOther; // computed jump
+			}
+			return k;
+		};
+		auto relative = [&](u32 k) { return k == okJump || k == okJump16 || k == okLoop || k == okCall || k == okData; };
+		auto target = [&](size_t i) -> s64 // byte offset from program start
+		{
+			return (s64)((i + 1) * sizeof(A256Cmd)) + (type(i) == okJump16 ? code[i].op2j.imm : (s32)code[i].op1i.imm);
+		};
+		auto index = [&](s64 t) -> s64 // instruction at byte offset or -1
+		{
+			return t >= 0 && t < size && !(t % sizeof(A256Cmd)) ? t / (s64)sizeof(A256Cmd) : -1;
+		};
+		auto jump = [&](size_t i) { return code[i].cmd == jrnz_cmd && code[i].op1i.r == 0 && code[i].op1i.r_mask == 0xff; }; // unconditional (j), not jrnz 0
+		auto retarget = [&](size_t i, s64 t) -> bool
+		{
+			const s64 offset = t - (s64)((i + 1) * sizeof(A256Cmd));
+			if (type(i) == okJump16)
+			{
+				if (offset != (s16)offset) return false;
+				code[i].op2j.imm = (s16)offset;
+			}
+			else
+			{
+				if (offset != (s32)offset) return false;
+				code[i].op1i.imm = (u32)offset;
+			}
+			return true;
+		};
+
+		// reachable code and starts of straight runs
+		std::vector<bool> reached(count, false);
+		std::vector<bool> leader(count, false);
+		std::vector<size_t> work;
+		if (count)
+		{
+			reached[0] = true;
+			leader[0] = true;
+			work.push_back(0);
+		}
+		while (!work.empty())
+		{
+			const size_t i = work.back();
+			work.pop_back();
+			const u32 k = type(i);
+			bool next = instr.func[code[i].cmd] != nullptr;
+			if (relative(k))
+			{
+				const s64 t = index(target(i));
+				if (t >= 0)
+				{
+					leader[(size_t)t] = true;
+					if (k != okData && !reached[(size_t)t])
+					{
+						reached[(size_t)t] = true;
+						work.push_back((size_t)t);
+					}
+				}
+			}
+			if (k == okRet || (k == okJump && jump(i)) || (code[i].cmd == stop_cmd && code[i].op1i.imm == 0))
+			{
+				next = false;
+			}
+			if (((relative(k) && k != okData) || k == okRet) && i + 1 < count)
+			{
+				leader[i + 1] = true; // control transfer ends the run
+			}
+			if (next && i + 1 < count && !reached[i + 1])
+			{
+				reached[i + 1] = true;
+				work.push_back(i + 1);
+			}
+		}
+		if (symbols)
+		{
+			for (auto& s : *symbols)
+			{
+				if (s.name[0] == '@' && s.value < count) leader[(size_t)s.value] = true;
+			}
+		}
+
+		std::vector<bool> removed(count, false);
+		auto remove = [&](size_t i)
+		{
+			removed[i] = true;
+			if (leader[i] && i + 1 < count) leader[i + 1] = true; // jumps to it land on the next one
+		};
+
+		// redirect jumps to unconditional jumps, remove jumps to the next instruction and instructions without effect
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!reached[i]) continue;
+			const u32 k = type(i);
+			if (k == okJump || k == okJump16 || k == okLoop || k == okCall)
+			{
+				s64 t = target(i);
+				for (size_t hops = 0; hops < count; hops++)
+				{
+					const s64 j = index(t);
+					if (j < 0 || !reached[(size_t)j] || !jump((size_t)j) || target((size_t)j) == t) break;
+					t = target((size_t)j);
+				}
+				if (t != target(i))
+				{
+					retarget(i, t);
+				}
+				if ((k == okJump || k == okJump16) && target(i) == (s64)((i + 1) * sizeof(A256Cmd)))
+				{
+					remove(i);
+				}
+			}
+			else if (k == okMoveBytes && (code[i].op2i.imm == 0 || code[i].op2i.r == code[i].op2i.a))
+			{
+				remove(i);
+			}
+			else if (k == okAddImm && code[i].op1i.imm == 0)
+			{
+				remove(i);
+			}
+		}
+
+		// fold setd + adddi and mmovb pairs
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!reached[i] || removed[i]) continue;
+			const u32 k = type(i);
+			if (k != okSet && k != okMoveBytes) continue;
+			for (size_t j = i + 1; j < count && reached[j] && !leader[j]; j++)
+			{
+				if (removed[j]) continue;
+				A256Cmd& a = code[i];
+				const A256Cmd& b = code[j];
+				if (k == okSet && type(j) == okAddImm && b.op1i.r == a.op1i.r && b.op1i.r_mask == a.op1i.r_mask)
+				{
+					a.op1i.imm += b.op1i.imm;
+				}
+				else if (k == okMoveBytes && type(j) == okMoveBytes && b.op2i.r == a.op2i.r && b.op2i.a == a.op2i.a)
+				{
+					a.op2i.imm |= b.op2i.imm;
+				}
+				else
+				{
+					break;
+				}
+				remove(j);
+			}
+		}
+
+		// remove results overwritten before use (backwards, dead[r] holds dwords written later in the run)
+		u8 dead[256];
+		memset(dead, 0, sizeof(dead));
+		for (size_t i = count; i-- > 0;)
+		{
+			if (!reached[i] || i + 1 == count || leader[i + 1] || !reached[i + 1])
+			{
+				memset(dead, 0, sizeof(dead)); // end of run
+			}
+			if (!reached[i] || removed[i]) continue;
+			const A256Cmd& c = code[i];
+			switch (type(i))
+			{
+			case okOp3:
+			case okSet:
+			case okAddImm:
+			{
+				const u8 r = c.op3.r;
+				const u8 mask = c.op3.r_mask;
+				if ((dead[r] & mask) == mask)
+				{
+					remove(i);
+				}
+				else if (type(i) == okAddImm)
+				{
+					dead[r] &= ~mask;
+				}
+				else
+				{
+					dead[r] |= mask;
+					if (type(i) == okOp3)
+					{
+						dead[c.op3.a] = 0;
+						dead[c.op3.b] = 0;
+					}
+				}
+				break;
+			}
+			case okMoveBytes:
+			{
+				u8 touched = 0; // dwords with selected bytes
+				u8 whole = 0; // dwords with all bytes selected
+				for (u32 d = 0; d < 8; d++)
+				{
+					const u32 bytes = (c.op2i.imm >> (d * 4)) & 15;
+					if (bytes) touched |= 1 << d;
+					if (bytes == 15) whole |= 1 << d;
+				}
+				if ((dead[c.op2i.r] & touched) == touched)
+				{
+					remove(i);
+				}
+				else
+				{
+					dead[c.op2i.r] |= whole;
+					dead[c.op2i.a] &= ~touched;
+				}
+				break;
+			}
+			default:
+			{
+				memset(dead, 0, sizeof(dead));
+				break;
+			}
+			}
+		}
+
+		// compact and rewrite relative immediates
+		std::vector<size_t> moved(count + 1); // new index of the first kept instruction at or after i
+		moved[count] = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			moved[count] += !removed[i];
+		}
+		for (size_t i = count, n = moved[count]; i-- > 0;)
+		{
+			if (!removed[i]) n--;
+			moved[i] = n;
+		}
+		auto map = [&](s64 t) -> s64
+		{
+			if (t < 0) return t;
+			if (t > size) return t - (s64)((count - moved[count]) * sizeof(A256Cmd));
+			return (s64)(moved[(size_t)(t / sizeof(A256Cmd))] * sizeof(A256Cmd)) + t % sizeof(A256Cmd);
+		};
+		std::vector<A256Cmd> res;
+		std::vector<bool> flow; // res[i] is code
+		res.reserve(moved[count]);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (removed[i]) continue;
+			flow.push_back(reached[i]);
+			if (!reached[i])
+			{
+				res.push_back(program[i]); // data, not un-fused or otherwise changed
+				continue;
+			}
+			if (relative(type(i)))
+			{
+				const s64 t = map(target(i));
+				const s64 offset = t - (s64)((moved[i] + 1) * sizeof(A256Cmd));
+				if (type(i) == okJump16)
+				{
+					code[i].op2j.imm = (s16)offset; // distances only shrink
+				}
+				else
+				{
+					code[i].op1i.imm = (u32)offset;
+				}
+			}
+			res.push_back(code[i]);
+		}
+
+		// superinstructions: only the opcode of the first instruction changes, positions and immediates stay valid
+		for (size_t i = 0; i < res.size(); i++)
+		{
+			for (const auto& f : instr.fusions)
+			{
+				bool match = i + f.length <= res.size();
+				for (u32 k = 0; match && k < f.length; k++)
+				{
+					match = flow[i + k] && specialized(res[i + k]) == f.parts[k];
+				}
+				if (match)
+				{
+					res[i].cmd = f.code;
+					i += f.length - 1;
+					break;
+				}
+			}
+		}
+
+		if (symbols)
+		{
+			for (auto& s : *symbols)
+			{
+				if (s.name[0] == '@' && s.value <= count) s.value = moved[(size_t)s.value];
+			}
+		}
+		if (links)
+		{
+			std::vector<A256Link> kept;
+			for (auto& l : *links)
+			{
+				if (l.pos < count && !removed[(size_t)l.pos]) kept.push_back(A256Link({ moved[(size_t)l.pos], l.symbol }));
+			}
+			links->swap(kept);
+		}
+		if (lines && lines->size() == count)
+		{
+			std::vector<u64> kept;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!removed[i]) kept.push_back((*lines)[i]);
+			}
+			lines->swap(kept);
+		}
+		return res;
+	}
+
 	bool execute()
 	{
-		op = *(A256Cmd*)reg[0]._uq[0];
+		const u64 np = reg[0]._uq[0];
+		cur = guest<const A256Cmd>(np);
 		reg[0]._uq[0] += sizeof(A256Cmd);
 		const u32 cmd = op.cmd;
-		(this->*instr.func[cmd])();
-		return (u64&)op != 0;
+		const A256Handler func = handler(op);
+#ifdef A256_PROFILE
+		const u64 start = __rdtsc();
+		(this->*func)();
+		profile.ops[cmd].count++;
+		profile.ops[cmd].cycles += __rdtsc() - start;
+		profile.sequence(np, cmd);
+#else
+		(this->*func)();
+#endif
+		return cur != nullptr;
+	}
+
+	template <A256Handler F>
+	bool follow(u64 np) // execute instruction at np in place unless control left the sequence (see fuse2_())
+	{
+		if (!cur || reg[0]._uq[0] != np)
+		{
+			return false;
+		}
+		cur = guest<const A256Cmd>(np);
+		reg[0]._uq[0] = np + sizeof(A256Cmd);
+		followed++;
+		(this->*F)();
+		return true;
+	}
+
+	template <A256Handler F1, A256Handler F2>
+	void fuse2_() // superinstruction: F1 with operands of this instruction, then the next instruction (F2) without dispatch
+	{
+		// later parts are read in place and not checked again (like pre-decoded programs, superinstructions assume unmodified code)
+		const u64 np = reg[0]._uq[0];
+		(this->*F1)();
+		follow<F2>(np);
+	}
+
+	template <A256Handler F1, A256Handler F2, A256Handler F3>
+	void fuse3_()
+	{
+		const u64 np = reg[0]._uq[0];
+		(this->*F1)();
+		if (follow<F2>(np))
+		{
+			follow<F3>(np + sizeof(A256Cmd));
+		}
+	}
+
+	void invalid() // unregistered instruction (used by handler())
+	{
+		trap(faultInstruction, op.cmd);
+	}
+
+	void reserved() // instruction with reserved bsc1 encoding (used by handler())
+	{
+		trap(faultBsc1, op.cmd);
+	}
+
+	bool valid(const A256Cmd& cmd) const // bsc1 operands of the instruction format use supported encodings
+	{
+		switch (instr.type[cmd.cmd])
+		{
+		case itOp1_bsc1_imm32: return A256Reg::bsc1_valid(cmd.op1i.r_mask);
+		case itOp2_bsc2_imm16:
+		case itOp3_m1_bsc2: return A256Reg::bsc1_valid(cmd.op3.a_mask) && A256Reg::bsc1_valid(cmd.op3.b_mask);
+		case itOp3_m2_bsc1: return A256Reg::bsc1_valid(cmd.op3.b_mask);
+		case itOp3_bsc3: return A256Reg::bsc1_valid(cmd.op3.r_mask) && A256Reg::bsc1_valid(cmd.op3.a_mask) && A256Reg::bsc1_valid(cmd.op3.b_mask);
+		default: return true;
+		}
+	}
+
+	A256Handler handler(const A256Cmd& cmd) const // registered handler, invalid() or reserved()
+	{
+		if (!instr.func[cmd.cmd])
+		{
+			return &A256Machine::invalid;
+		}
+		return valid(cmd) ? instr.func[cmd.cmd] : &A256Machine::reserved;
+	}
+
+	u32 kinds(const A256Cmd& cmd) const // selectors of specialized handler as 1 + a * 3 + b (0 if decode() keeps the registered one)
+	{
+		if (!instr.spec[cmd.cmd] || !instr.func[cmd.cmd] || !valid(cmd))
+		{
+			return 0;
+		}
+		const u32 a = bsc(cmd.op3.a_mask);
+		const u32 b = bsc(cmd.op3.b_mask);
+		return a != bscAny && b != bscAny ? 1 + a * 3 + b : 0;
+	}
+
+	A256Handler specialized(const A256Cmd& cmd) const // handler() or its variant for simple selectors
+	{
+		const u32 k = kinds(cmd);
+		return k ? instr.variant[instr.spec[cmd.cmd]][(k - 1) / 3][(k - 1) % 3] : handler(cmd);
+	}
+
+	A256Threaded decode(const std::vector<A256Cmd>& program) const
+	{
+		return decode(program.data(), program.size());
+	}
+
+	A256Threaded decode(const A256Cmd* program, size_t size) const
+	{
+		A256Threaded res;
+		res.base = program;
+		res.size = size;
+		res.code.resize(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			res.code[i].func = specialized(program[i]);
+			res.code[i].args = program[i];
+		}
+		return res;
+	}
+
+	void step(const A256Threaded& program) // execute one instruction of pre-decoded program
+	{
+		const u64 np = reg[0]._uq[0];
+		const u64 offset = (np - (u64)program.base) & mem_mask; // forks of the guest space share the program (see A256Memory::fork())
+		if (offset < program.size * sizeof(A256Cmd) && !(offset % sizeof(A256Cmd)))
+		{
+			// $NP is maintained as usual, so relative jumps, call/ret and addr/ldr* still work
+			const A256Decoded& next = program.code[offset / sizeof(A256Cmd)];
+			reg[0]._uq[0] = np + sizeof(A256Cmd);
+			cur = &next.args;
+#ifdef A256_PROFILE
+			const size_t index = offset / sizeof(A256Cmd);
+			const u32 cmd = next.args.cmd;
+			const u64 start = __rdtsc();
+			(this->*next.func)();
+			const u64 cycles = __rdtsc() - start;
+			if (profile.pos.size() < program.size)
+			{
+				profile.pos.resize(program.size);
+			}
+			profile.ops[cmd].count++;
+			profile.ops[cmd].cycles += cycles;
+			profile.pos[index].count++;
+			profile.pos[index].cycles += cycles;
+			profile.sequence(np, cmd | kinds(next.args) << 16);
+#else
+			(this->*next.func)();
+#endif
+		}
+		else // $NP is outside of the decoded program
+		{
+			execute();
+		}
+	}
+
+	u32 run(const A256Threaded& program, u64 budget = ~0ull) // execute program until exit (stop 0), fault or budget (instructions), returns A256Fault
+	{
+		fault = faultNone;
+		const u64 start = followed;
+		u64 count = 0; // dispatches, a superinstruction is charged all its parts (may overrun budget by them)
+		while (count + (followed - start) < budget)
+		{
+			step(program);
+			count++;
+			if (!cur)
+			{
+				if (fault)
+				{
+					flush(); // buffered output goes before the fault message
+				}
+				return fault;
+			}
+		}
+		yield(count + (followed - start));
+		return fault;
+	}
+
+	void yield(u64 count) // budget exhausted: all state is in registers, so calling run() again continues at $NP
+	{
+		fault = faultBudget;
+		fault_addr = reg[0]._uq[0];
+		fault_value = count;
 	}
 };
 
@@ -0,0 +1,770 @@
+#pragma once
+
+#include "A256Interpreter.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <sys/mman.h>
+#include <cpuid.h>
+#endif
+
+// x86-64 AVX2 translator for pre-decoded A256 programs
+
+/*
+1) straight runs of supported instructions are translated to native blocks
+2) the register file is accessed through the pinned pointer passed as first argument (rcx or rdi)
+3) operands are loaded to ymm1 and ymm2, result is computed in ymm0 and stored with r_mask (vpmaskmovd)
+4) supported operand selectors: full data, not, immediates and broadcast of word/dword/qword/dqword with packing
+5) blocks start at jump targets and after branches or unsupported instructions
+6) jrnz/jrz and loopd/loopq (one lane) terminate the block, jump to the start of the same block is a native loop
+   while the instruction budget (second argument, rdx or rsi) is positive, every pass subtracts its length
+7) other branches are interpreted, their targets start blocks
+8) $NP is updated only when the block returns, so instructions reading or writing $00 are not translated
+9) everything else is executed by the interpreter (A256Machine::step())
+10) nothing is translated if A256_PROFILE is defined
+11) superinstructions (see A256Fused.h) are translated as their first instruction
+*/
+
+struct A256Jit
+{
+	typedef void (*A256Block)(A256Reg* reg, s64* budget);
+
+	enum A256JitType
+	{
+		jtNone,
+		jtSet, // setd
+		jtOp3, // r = a op b (VEX.256 instruction)
+		jtCmp3, // r = a op b, imm8 (vcmpps/vcmppd)
+		jtJumpNZ, // jrnz
+		jtJumpZ, // jrz
+		jtLoop, // loopd, loopq (code is lane size)
+		jtBranch, // jrall, jrnall (not translated, imm32 target)
+		jtBranch16, // jreq*, jrne*, jrlt* (not translated, imm16 target)
+		jtCall, // not translated, but the next instruction starts a block
+	};
+
+	struct A256JitOp
+	{
+		A256JitType type;
+		u8 map; // 1: 0F, 2: 0F38
+		u8 pp; // 0: none, 1: 66, 2: F3, 3: F2
+		u8 code; // opcode
+		u8 imm; // comparison predicate
+		A256Reg (*constant)(u8 code, u8 regnum); // immediate operand of the operating type
+	};
+
+	struct A256Emitter
+	{
+		std::vector<u8> code;
+		std::vector<A256Reg> consts;
+		std::vector<std::pair<size_t, size_t>> fixups; // rip-relative disp32 offset, constant index
+
+#ifdef _WIN32
+		static const u8 rbase = 1; // rcx
+		static const u8 rbudget = 2; // rdx
+#else
+		static const u8 rbase = 7; // rdi
+		static const u8 rbudget = 6; // rsi
+#endif
+
+		void byte(u8 data)
+		{
+			code.push_back(data);
+		}
+
+		void dword(u32 data)
+		{
+			for (u32 i = 0; i < 4; i++)
+			{
+				byte((u8)(data >> (i * 8)));
+			}
+		}
+
+		void vex(u8 map, u8 pp, u8 r, u8 v, u8 b, u8 opcode) // VEX.256.W0 (3-byte form)
+		{
+			byte(0xc4);
+			byte((u8)((~r & 8) << 4 | 0x40 | (~b & 8) << 2 | map));
+			byte((u8)((~v & 15) << 3 | 4 | pp));
+			byte(opcode);
+		}
+
+		void mem(u8 r, s32 disp) // [rbase + disp32]
+		{
+			byte((u8)(0x80 | (r & 7) << 3 | rbase));
+			dword((u32)disp);
+		}
+
+		void rr(u8 r, u8 rm)
+		{
+			byte((u8)(0xc0 | (r & 7) << 3 | (rm & 7)));
+		}
+
+		void load(u8 y, s32 disp) // vmovdqu ymm, [rbase + disp32]
+		{
+			vex(1, 2, y, 0, rbase, 0x6f);
+			mem(y, disp);
+		}
+
+		void load(u8 y, const A256Reg& data) // vmovdqu ymm, [rip + constant]
+		{
+			vex(1, 2, y, 0, 0, 0x6f);
+			byte((u8)((y & 7) << 3 | 5));
+			fixups.push_back(std::make_pair(code.size(), consts.size()));
+			consts.push_back(data);
+			dword(0);
+		}
+
+		void broadcast(u8 y, u8 opcode, s32 disp) // vpbroadcast*/vbroadcasti128 ymm, [rbase + disp32]
+		{
+			vex(2, 1, y, 0, rbase, opcode);
+			mem(y, disp);
+		}
+
+		void store(u8 y, s32 disp) // vmovdqu [rbase + disp32], ymm
+		{
+			vex(1, 2, y, 0, rbase, 0x7f);
+			mem(y, disp);
+		}
+
+		void store(u8 y, u8 ymask, s32 disp) // vpmaskmovd [rbase + disp32], ymask, ymm
+		{
+			vex(2, 1, y, ymask, rbase, 0x8e);
+			mem(y, disp);
+		}
+
+		void op3(u8 map, u8 pp, u8 opcode, u8 r, u8 a, u8 b) // vop ymm, ymm, ymm
+		{
+			vex(map, pp, r, a, b, opcode);
+			rr(r, b);
+		}
+
+		void ptest(u8 y) // vptest ymm, ymm
+		{
+			vex(2, 1, y, 0, y, 0x17);
+			rr(y, y);
+		}
+
+		void cmp0(u32 size, s32 disp) // cmp (word/dword/qword) [rbase + disp32], 0
+		{
+			if (size == 2) byte(0x66);
+			if (size == 8) byte(0x48);
+			byte(0x83);
+			mem(7, disp);
+			byte(0);
+		}
+
+		void dec(u32 size, s32 disp) // sub (dword/qword) [rbase + disp32], 1
+		{
+			if (size == 8) byte(0x48);
+			byte(0x83);
+			mem(5, disp);
+			byte(1);
+		}
+
+		void add_np(u32 value) // add qword [rbase], imm32 ($NP)
+		{
+			byte(0x48);
+			byte(0x81);
+			mem(0, 0);
+			dword(value);
+		}
+
+		void charge(u32 count) // sub qword [rbudget], imm32
+		{
+			byte(0x48);
+			byte(0x81);
+			byte((u8)(5 << 3 | rbudget));
+			dword(count);
+		}
+
+		void again(size_t top) // jump to the start of the block if budget remains, otherwise return ($NP is unchanged)
+		{
+			byte(0x48); // cmp qword [rbudget], 0
+			byte(0x83);
+			byte((u8)(7 << 3 | rbudget));
+			byte(0);
+			jcc(0xf, top); // jg
+			exit(0);
+		}
+
+		void exit(u32 np) // update $NP and return
+		{
+			add_np(np);
+			byte(0xc5); // vzeroupper
+			byte(0xf8);
+			byte(0x77);
+			byte(0xc3); // ret
+		}
+
+		size_t jcc(u8 cc) // jcc rel32 (returns offset of rel32)
+		{
+			byte(0x0f);
+			byte(0x80 | cc);
+			dword(0);
+			return code.size() - 4;
+		}
+
+		void jcc(u8 cc, size_t target)
+		{
+			patch(jcc(cc), target);
+		}
+
+		void patch(size_t rel32, size_t target)
+		{
+			const u32 rel = (u32)(target - (rel32 + 4));
+			memcpy(&code[rel32], &rel, sizeof(rel));
+		}
+	};
+
+	std::vector<A256JitOp> ops; // indexed by opcode
+	std::vector<A256Block> blocks; // indexed by instruction (nullptr if interpreted)
+	const A256Machine::A256Threaded* program;
+	u8* memory;
+	size_t memory_size;
+
+	A256Jit(const A256Machine& vm, const A256Machine::A256Threaded& program)
+		: ops(vm.instr.max_num + 1)
+		, blocks(program.size)
+		, program(&program)
+		, memory(nullptr)
+		, memory_size(0)
+	{
+#define JIT(f, t, m, p, c, i, T) ops[vm.instr.find(&A256Machine::f)] = A256JitOp({ t, m, p, c, i, &A256Jit::constant<T> })
+
+		JIT(setd, jtSet, 0, 0, 0, 0, u32);
+		JIT(jrnz, jtJumpNZ, 0, 0, 0, 0, u64);
+		JIT(jrz, jtJumpZ, 0, 0, 0, 0, u64);
+		JIT(loopd, jtLoop, 0, 0, 4, 0, u32);
+		JIT(loopq, jtLoop, 0, 0, 8, 0, u64);
+		JIT(jrall, jtBranch, 0, 0, 0, 0, u64);
+		JIT(jrnall, jtBranch, 0, 0, 0, 0, u64);
+		JIT(jreqd, jtBranch16, 0, 0, 0, 0, u32);
+		JIT(jrned, jtBranch16, 0, 0, 0, 0, u32);
+		JIT(jrltsd, jtBranch16, 0, 0, 0, 0, s32);
+		JIT(jrltud, jtBranch16, 0, 0, 0, 0, u32);
+		JIT(call, jtCall, 0, 0, 0, 0, u64);
+
+		JIT(addfs, jtOp3, 1, 0, 0x58, 0, f32);
+		JIT(addfd, jtOp3, 1, 1, 0x58, 0, f64);
+		JIT(addb, jtOp3, 1, 1, 0xfc, 0, s8);
+		JIT(addw, jtOp3, 1, 1, 0xfd, 0, s16);
+		JIT(addd, jtOp3, 1, 1, 0xfe, 0, s32);
+		JIT(addq, jtOp3, 1, 1, 0xd4, 0, s64);
+
+		JIT(subfs, jtOp3, 1, 0, 0x5c, 0, f32);
+		JIT(subfd, jtOp3, 1, 1, 0x5c, 0, f64);
+		JIT(subb, jtOp3, 1, 1, 0xf8, 0, s8);
+		JIT(subw, jtOp3, 1, 1, 0xf9, 0, s16);
+		JIT(subd, jtOp3, 1, 1, 0xfa, 0, s32);
+		JIT(subq, jtOp3, 1, 1, 0xfb, 0, s64);
+
+		JIT(mulfs, jtOp3, 1, 0, 0x59, 0, f32);
+		JIT(mulfd, jtOp3, 1, 1, 0x59, 0, f64);
+		JIT(mulw, jtOp3, 1, 1, 0xd5, 0, s16);
+		JIT(muld, jtOp3, 2, 1, 0x40, 0, s32);
+
+		JIT(divfs, jtOp3, 1, 0, 0x5e, 0, f32);
+		JIT(divfd, jtOp3, 1, 1, 0x5e, 0, f64);
+
+		JIT(andfs, jtOp3, 1, 1, 0xdb, 0, f32);
+		JIT(andfd, jtOp3, 1, 1, 0xdb, 0, f64);
+		JIT(andb, jtOp3, 1, 1, 0xdb, 0, s8);
+		JIT(andw, jtOp3, 1, 1, 0xdb, 0, s16);
+		JIT(andd, jtOp3, 1, 1, 0xdb, 0, s32);
+		JIT(andq, jtOp3, 1, 1, 0xdb, 0, s64);
+
+		JIT(orfs, jtOp3, 1, 1, 0xeb, 0, f32);
+		JIT(orfd, jtOp3, 1, 1, 0xeb, 0, f64);
+		JIT(orb, jtOp3, 1, 1, 0xeb, 0, s8);
+		JIT(orw, jtOp3, 1, 1, 0xeb, 0, s16);
+		JIT(ord, jtOp3, 1, 1, 0xeb, 0, s32);
+		JIT(orq, jtOp3, 1, 1, 0xeb, 0, s64);
+
+		JIT(xorfs, jtOp3, 1, 1, 0xef, 0, f32);
+		JIT(xorfd, jtOp3, 1, 1, 0xef, 0, f64);
+		JIT(xorb, jtOp3, 1, 1, 0xef, 0, s8);
+		JIT(xorw, jtOp3, 1, 1, 0xef, 0, s16);
+		JIT(xord, jtOp3, 1, 1, 0xef, 0, s32);
+		JIT(xorq, jtOp3, 1, 1, 0xef, 0, s64);
+
+		JIT(ceqfs, jtCmp3, 1, 0, 0xc2, 0x00, f32); // EQ_OQ
+		JIT(ceqfd, jtCmp3, 1, 1, 0xc2, 0x00, f64);
+		JIT(ceqb, jtOp3, 1, 1, 0x74, 0, s8);
+		JIT(ceqw, jtOp3, 1, 1, 0x75, 0, s16);
+		JIT(ceqd, jtOp3, 1, 1, 0x76, 0, s32);
+		JIT(ceqq, jtOp3, 2, 1, 0x29, 0, s64);
+
+		JIT(cgtfs, jtCmp3, 1, 0, 0xc2, 0x1e, f32); // GT_OQ
+		JIT(cgtfd, jtCmp3, 1, 1, 0xc2, 0x1e, f64);
+		JIT(cgtsb, jtOp3, 1, 1, 0x64, 0, s8);
+		JIT(cgtsw, jtOp3, 1, 1, 0x65, 0, s16);
+		JIT(cgtsd, jtOp3, 1, 1, 0x66, 0, s32);
+		JIT(cgtsq, jtOp3, 2, 1, 0x37, 0, s64);
+
+		JIT(minfs, jtOp3, 1, 0, 0x5d, 0, f32);
+		JIT(minfd, jtOp3, 1, 1, 0x5d, 0, f64);
+		JIT(minsb, jtOp3, 2, 1, 0x38, 0, s8);
+		JIT(minsw, jtOp3, 1, 1, 0xea, 0, s16);
+		JIT(minsd, jtOp3, 2, 1, 0x39, 0, s32);
+		JIT(minub, jtOp3, 1, 1, 0xda, 0, u8);
+		JIT(minuw, jtOp3, 2, 1, 0x3a, 0, u16);
+		JIT(minud, jtOp3, 2, 1, 0x3b, 0, u32);
+
+		JIT(maxfs, jtOp3, 1, 0, 0x5f, 0, f32);
+		JIT(maxfd, jtOp3, 1, 1, 0x5f, 0, f64);
+		JIT(maxsb, jtOp3, 2, 1, 0x3c, 0, s8);
+		JIT(maxsw, jtOp3, 1, 1, 0xee, 0, s16);
+		JIT(maxsd, jtOp3, 2, 1, 0x3d, 0, s32);
+		JIT(maxub, jtOp3, 1, 1, 0xde, 0, u8);
+		JIT(maxuw, jtOp3, 2, 1, 0x3e, 0, u16);
+		JIT(maxud, jtOp3, 2, 1, 0x3f, 0, u32);
+
+#undef JIT
+
+#ifndef A256_PROFILE // native blocks would hide instructions from the profile
+		if (supported_cpu())
+		{
+			translate(vm);
+		}
+#endif
+	}
+
+	A256Jit(const A256Jit&) = delete;
+	A256Jit& operator =(const A256Jit&) = delete;
+
+	~A256Jit()
+	{
+		if (memory)
+		{
+#ifdef _WIN32
+			VirtualFree(memory, 0, MEM_RELEASE);
+#else
+			munmap(memory, memory_size);
+#endif
+		}
+	}
+
+	template<typename T>
+	static A256Reg constant(u8 code, u8 regnum)
+	{
+		A256Reg zero = {};
+		return zero.bsc1<T>(code, regnum);
+	}
+
+	static bool supported_cpu() // AVX2 and OS support for ymm state
+	{
+		int info[4];
+#ifdef _WIN32
+		__cpuid(info, 1);
+#else
+		__cpuid(1, info[0], info[1], info[2], info[3]);
+#endif
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) // OSXSAVE, AVX
+		{
+			return false;
+		}
+		if ((_xgetbv(0) & 6) != 6) // xmm and ymm state
+		{
+			return false;
+		}
+#ifdef _WIN32
+		__cpuidex(info, 7, 0);
+#else
+		__cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+		return (info[1] & (1 << 5)) != 0; // AVX2
+	}
+
+	static bool operand(u8 r, u8 code) // check if bsc1 operand can be translated
+	{
+		if (code >= 0xfa && code <= 0xfd)
+		{
+			return true; // immediate
+		}
+		if (r == 0)
+		{
+			return false; // $NP is not updated inside of the block
+		}
+		return code >= 0xfe || (code >= 0x40 && code <= 0x4f) || (code >= 0x80 && code <= 0x87) || (code >= 0xc0 && code <= 0xc3) || code == 0xe0 || code == 0xe1;
+	}
+
+	static s32 lane(u8 size, u8 mask) // index of the only counter selected by loopd/loopq mask (-1 if none or many)
+	{
+		s32 res = -1;
+		for (u32 i = 0; i < 8u / (size / 4); i++)
+		{
+			if (mask & (((1 << (size / 4)) - 1) << (i * size / 4)))
+			{
+				if (res >= 0)
+				{
+					return -1;
+				}
+				res = i;
+			}
+		}
+		return res;
+	}
+
+	static bool target(const A256JitOp& info, const A256Cmd& cmd, s32& rel) // relative offset of branch
+	{
+		switch (info.type)
+		{
+		case jtJumpNZ:
+		case jtJumpZ:
+		case jtLoop:
+		case jtBranch:
+		case jtCall:
+		{
+			rel = (s32)cmd.op1i.imm;
+			return true;
+		}
+		case jtBranch16:
+		{
+			rel = cmd.op2j.imm;
+			return true;
+		}
+		default:
+		{
+			return false;
+		}
+		}
+	}
+
+	bool supported(const A256Cmd& cmd) const
+	{
+		if (cmd.cmd >= ops.size())
+		{
+			return false;
+		}
+		switch (ops[cmd.cmd].type)
+		{
+		case jtSet:
+		{
+			return cmd.op1i.r != 0;
+		}
+		case jtOp3:
+		case jtCmp3:
+		{
+			return cmd.op3.r != 0 && operand(cmd.op3.a, cmd.op3.a_mask) && operand(cmd.op3.b, cmd.op3.b_mask);
+		}
+		case jtJumpNZ:
+		case jtJumpZ:
+		{
+			const u8 code = cmd.op1i.r_mask;
+			if (cmd.op1i.r == 0)
+			{
+				return code == 0xff || (code >= 0xfa && code <= 0xfd); // $NP is never zero
+			}
+			return code == 0xff || (code >= 0xfa && code <= 0xfd) || (code >= 0x40 && code <= 0x4f) || (code >= 0x80 && code <= 0x87) || (code >= 0xc0 && code <= 0xc3);
+		}
+		case jtLoop:
+		{
+			return cmd.op1i.r != 0 && lane(ops[cmd.cmd].code, cmd.op1i.r_mask) >= 0;
+		}
+		default:
+		{
+			return false;
+		}
+		}
+	}
+
+	void translate(const A256Machine& vm)
+	{
+		const size_t count = program->size;
+		std::vector<A256Cmd> plain(program->base, program->base + count);
+		for (const auto& f : vm.instr.fusions)
+		{
+			for (auto& cmd : plain)
+			{
+				if (cmd.cmd == f.code)
+				{
+					cmd.cmd = f.seq[0]; // superinstruction is translated as its first part, the rest follows in place
+				}
+			}
+		}
+		const A256Cmd* const cmds = plain.data();
+
+		// find block leaders
+		std::vector<bool> leader(count, false);
+		for (size_t i = 0; i < count; i++)
+		{
+			const A256Cmd& cmd = cmds[i];
+			if (i == 0 || !supported(cmds[i - 1]))
+			{
+				leader[i] = true;
+			}
+			s32 rel;
+			if (cmd.cmd < ops.size() && target(ops[cmd.cmd], cmd, rel))
+			{
+				const s64 dest = (s64)i + 1 + rel / (s64)sizeof(A256Cmd);
+				if (rel % (s32)sizeof(A256Cmd) == 0 && dest >= 0 && dest < (s64)count)
+				{
+					leader[(size_t)dest] = true;
+				}
+				if (i + 1 < count)
+				{
+					leader[i + 1] = true;
+				}
+			}
+		}
+
+		A256Emitter e;
+		std::vector<size_t> offsets(count, ~(size_t)0);
+		for (size_t start = 0; start < count; start++)
+		{
+			if (!leader[start] || !supported(cmds[start]))
+			{
+				continue;
+			}
+			offsets[start] = e.code.size();
+			size_t i = start;
+			while (true)
+			{
+				const A256Cmd& cmd = cmds[i];
+				const A256JitOp& info = ops[cmd.cmd];
+				if (info.type == jtJumpNZ || info.type == jtJumpZ || info.type == jtLoop)
+				{
+					e.charge((u32)(i + 1 - start));
+					jump(e, info, cmd, start, i, offsets[start]);
+					break;
+				}
+				emit(e, info, cmd);
+				i++;
+				if (i >= count || leader[i] || !supported(cmds[i]))
+				{
+					e.charge((u32)(i - start));
+					e.exit((u32)((i - start) * sizeof(A256Cmd)));
+					break;
+				}
+			}
+		}
+
+		if (e.code.empty())
+		{
+			return;
+		}
+
+		// layout: constants, then code
+		const size_t consts_size = e.consts.size() * sizeof(A256Reg);
+		for (auto& f : e.fixups)
+		{
+			const u32 disp = (u32)(f.second * sizeof(A256Reg) - (consts_size + f.first + 4));
+			memcpy(&e.code[f.first], &disp, sizeof(disp));
+		}
+		memory_size = consts_size + e.code.size();
+#ifdef _WIN32
+		memory = (u8*)VirtualAlloc(nullptr, memory_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+		memory = (u8*)mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) memory = nullptr;
+#endif
+		if (!memory)
+		{
+			throw fmt::format(__FUNCTION__"(): memory allocation failed.");
+		}
+		if (consts_size)
+		{
+			memcpy(memory, e.consts.data(), consts_size);
+		}
+		memcpy(memory + consts_size, e.code.data(), e.code.size());
+#ifdef _WIN32
+		DWORD old;
+		VirtualProtect(memory, memory_size, PAGE_EXECUTE_READ, &old);
+		FlushInstructionCache(GetCurrentProcess(), memory, memory_size);
+#else
+		mprotect(memory, memory_size, PROT_READ | PROT_EXEC);
+#endif
+		for (size_t i = 0; i < count; i++)
+		{
+			if (offsets[i] != ~(size_t)0)
+			{
+				blocks[i] = (A256Block)(memory + consts_size + offsets[i]);
+			}
+		}
+	}
+
+	static void load(A256Emitter& e, const A256JitOp& info, u8 y, u8 r, u8 code)
+	{
+		const s32 disp = r * sizeof(A256Reg);
+		if (code >= 0xfa && code <= 0xfd)
+		{
+			e.load(y, info.constant(code, r));
+		}
+		else if (code >= 0xfe)
+		{
+			e.load(y, disp);
+			if (code == 0xfe)
+			{
+				e.op3(1, 1, 0x76, 3, 3, 3); // vpcmpeqd ymm3, ymm3, ymm3
+				e.op3(1, 1, 0xef, y, y, 3); // vpxor
+			}
+		}
+		else if (code < 0x80)
+		{
+			e.broadcast(y, 0x79, disp + (code % 16) * sizeof(u16)); // vpbroadcastw
+		}
+		else if (code < 0xc0)
+		{
+			e.broadcast(y, 0x58, disp + (code % 8) * sizeof(u32)); // vpbroadcastd
+		}
+		else if (code < 0xe0)
+		{
+			e.broadcast(y, 0x59, disp + (code % 4) * sizeof(u64)); // vpbroadcastq
+		}
+		else
+		{
+			e.broadcast(y, 0x5a, disp + (code % 2) * sizeof(u128)); // vbroadcasti128
+		}
+	}
+
+	static void save(A256Emitter& e, u8 r, u8 mask) // RSAVE1(reg[r], ymm0, mask)
+	{
+		if (mask == 0xff)
+		{
+			e.store(0, r * sizeof(A256Reg));
+		}
+		else if (mask)
+		{
+			A256Reg m;
+			for (u32 i = 0; i < 8; i++)
+			{
+				m._ud[i] = (mask & (1 << i)) ? ~0u : 0;
+			}
+			e.load(3, m);
+			e.store(0, 3, r * sizeof(A256Reg));
+		}
+	}
+
+	static void emit(A256Emitter& e, const A256JitOp& info, const A256Cmd& cmd)
+	{
+		switch (info.type)
+		{
+		case jtSet:
+		{
+			e.load(0, A256Reg::set<u32>(cmd.op1i.imm));
+			save(e, cmd.op1i.r, cmd.op1i.r_mask);
+			break;
+		}
+		case jtOp3:
+		case jtCmp3:
+		{
+			load(e, info, 1, cmd.op3.a, cmd.op3.a_mask);
+			load(e, info, 2, cmd.op3.b, cmd.op3.b_mask);
+			e.op3(info.map, info.pp, info.code, 0, 1, 2);
+			if (info.type == jtCmp3)
+			{
+				e.byte(info.imm);
+			}
+			save(e, cmd.op3.r, cmd.op3.r_mask);
+			break;
+		}
+		default:
+		{
+			throw fmt::format(__FUNCTION__"(): unexpected instruction 0x%x.", cmd.cmd);
+		}
+		}
+	}
+
+	static void jump(A256Emitter& e, const A256JitOp& info, const A256Cmd& cmd, size_t start, size_t i, size_t top)
+	{
+		const u32 next = (u32)((i + 1 - start) * sizeof(A256Cmd));
+		const u32 taken = next + cmd.op1i.imm;
+		const bool loop = taken == 0; // jump to the start of this block ($NP is unchanged)
+		const u8 r = cmd.op1i.r;
+		const u8 code = cmd.op1i.r_mask;
+		const u8 cc = info.type == jtJumpZ ? 0x4 : 0x5; // jz or jnz if taken
+
+		if (info.type == jtLoop)
+		{
+			e.dec(info.code, r * sizeof(A256Reg) + lane(info.code, code) * info.code);
+		}
+		else if ((r == 0 && code == 0xff) || (code >= 0xfa && code <= 0xfd))
+		{
+			// condition is known: $NP is never zero, immediates (e.g. jrz 0) are constants
+			const A256Reg value = code == 0xff ? A256Reg::set<u64>(1) : constant<u64>(code, r);
+			const bool nz = (value._uq[0] | value._uq[1] | value._uq[2] | value._uq[3]) != 0;
+			if (nz != (info.type == jtJumpNZ))
+			{
+				e.exit(next);
+			}
+			else if (loop)
+			{
+				e.again(top);
+			}
+			else
+			{
+				e.exit(taken);
+			}
+			return;
+		}
+		else if (code == 0xff)
+		{
+			e.load(1, r * sizeof(A256Reg));
+			e.ptest(1);
+		}
+		else if (code < 0x80)
+		{
+			e.cmp0(2, r * sizeof(A256Reg) + (code % 16) * sizeof(u16));
+		}
+		else if (code < 0xc0)
+		{
+			e.cmp0(4, r * sizeof(A256Reg) + (code % 8) * sizeof(u32));
+		}
+		else
+		{
+			e.cmp0(8, r * sizeof(A256Reg) + (code % 4) * sizeof(u64));
+		}
+
+		const size_t rel = e.jcc(cc);
+		e.exit(next);
+		e.patch(rel, e.code.size());
+		if (loop)
+		{
+			e.again(top);
+		}
+		else
+		{
+			e.exit(taken);
+		}
+	}
+
+	u32 run(A256Machine& vm, u64 budget = ~0ull) // execute program until exit (stop 0), fault or budget (instructions), returns A256Machine::A256Fault
+	{
+		const u64 base = (u64)program->base;
+		const u64 size = program->size * sizeof(A256Cmd);
+		const s64 limit = (s64)std::min<u64>(budget, LLONG_MAX);
+		s64 left = limit; // blocks may overrun it by their length
+		vm.cur = program->base; // not stopped
+		vm.fault = A256Machine::faultNone;
+		while (left > 0)
+		{
+			const u64 offset = (vm.reg[0]._uq[0] - base) & vm.mem_mask;
+			A256Block block;
+			if (offset < size && !(offset % sizeof(A256Cmd)) && (block = blocks[offset / sizeof(A256Cmd)]))
+			{
+				block(vm.reg, &left);
+			}
+			else
+			{
+				const u64 followed = vm.followed;
+				vm.step(*program);
+				left -= 1 + (s64)(vm.followed - followed); // superinstructions charge all their parts
+			}
+			if (!vm.cur)
+			{
+				if (vm.fault)
+				{
+					vm.flush(); // buffered output goes before the fault message
+				}
+				return vm.fault;
+			}
+		}
+		vm.yield((u64)(limit - left));
+		return vm.fault;
+	}
+};
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "A256Interpreter.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// sandboxed guest address space
+
+/*
+1) one region of 2^n bytes aligned to its size, reserved between inaccessible guard areas
+2) attached machine maps every guest address to base | (address & (size - 1)) (see A256Machine::guest()),
+   so ld*, st*, ldr*, str*, push*, pop*, call, ret, stop 12 and instruction fetch can't leave the region
+3) offsets and host pointers into the region are both valid guest addresses, anything else wraps around inside
+4) one accessible page after the region absorbs the tail of accesses starting near its end (up to 32 bytes)
+5) load() copies program to the region start, attaches machine and puts both stacks at the region end:
+   [code][free][stack ($BP, $SP)][call stack ($CS)]
+6) detached machine (default) uses host pointers, the mask is ~0 so the cost is the same
+7) A256Snapshot freezes registers and the region in a shared memory object (memfd or pagefile section),
+   fork() maps it copy-on-write into a new region of the same size, so forks copy only the pages they write
+   (the old region is released only after the mapping succeeded, machine state is unchanged on failure)
+8) guest addresses in registers stay valid in every fork (they are masked into any region of the same size),
+   pre-decoded program and A256Jit are shared too
+*/
+
+struct A256Snapshot // frozen state of a sandboxed machine (see A256Memory::fork())
+{
+	A256Reg reg[256];
+	s64 exit_status;
+	u64 size; // region size
+#ifdef _WIN32
+	HANDLE section;
+#else
+	int file;
+#endif
+
+	explicit A256Snapshot(const A256Machine& vm) // buffered output is not included
+		: exit_status(vm.exit_status)
+		, size(vm.mem_mask + 1)
+	{
+		if (!vm.mem_base)
+		{
+			throw fmt::format(__FUNCTION__"(): machine is not sandboxed.");
+		}
+		memcpy(reg, vm.reg, sizeof(reg));
+		u8* data = nullptr;
+#ifdef _WIN32
+		section = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+		if (section)
+		{
+			data = (u8*)MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, size);
+		}
+#else
+		file = memfd_create("A256Snapshot", MFD_CLOEXEC);
+		if (file >= 0 && !ftruncate(file, size))
+		{
+			data = (u8*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			if (data == MAP_FAILED) data = nullptr;
+		}
+#endif
+		if (!data)
+		{
+			release();
+			throw fmt::format(__FUNCTION__"(): memory allocation failed (0x%llx bytes).", size);
+		}
+		const u64* src = (const u64*)vm.mem_base;
+		for (u64 i = 0; i < size / sizeof(u64); i += 0x1000 / sizeof(u64))
+		{
+			// zero pages are left unallocated
+			for (u64 j = i; j < i + 0x1000 / sizeof(u64); j++)
+			{
+				if (src[j])
+				{
+					memcpy(data + i * sizeof(u64), src + i, 0x1000);
+					break;
+				}
+			}
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(data, size);
+#endif
+	}
+
+	A256Snapshot(const A256Snapshot&) = delete;
+	A256Snapshot& operator =(const A256Snapshot&) = delete;
+
+	~A256Snapshot() // forks keep their mappings
+	{
+		release();
+	}
+
+	void release()
+	{
+#ifdef _WIN32
+		if (section)
+		{
+			CloseHandle(section);
+			section = nullptr;
+		}
+#else
+		if (file >= 0)
+		{
+			close(file);
+			file = -1;
+		}
+#endif
+	}
+};
+
+struct A256Memory
+{
+	static const u64 guard = 0x10000; // inaccessible bytes around the region (allocation granularity on Windows)
+	static const u64 page = 0x1000; // accessible tail
+
+	u8* base; // region start
+	u64 size; // power of two
+	u8* reserved; // whole reservation including guard areas (Windows: lower guard area)
+	u64 reserved_size;
+#ifdef _WIN32
+	u8* upper; // upper guard area with accessible tail, the region is a separate allocation
+	bool view; // region is a mapped snapshot
+#endif
+
+	explicit A256Memory(u64 min_size)
+		: base(nullptr)
+		, size(guard)
+		, reserved(nullptr)
+		, reserved_size(0)
+#ifdef _WIN32
+		, upper(nullptr)
+		, view(false)
+#endif
+	{
+		while (size < min_size)
+		{
+			if (size >> 62)
+			{
+				throw fmt::format(__FUNCTION__"(): invalid size 0x%llx.", min_size);
+			}
+			size *= 2;
+		}
+		allocate(nullptr);
+	}
+
+	explicit A256Memory(const A256Snapshot& snapshot) // region is a copy-on-write view of snapshot (see fork())
+		: base(nullptr)
+		, size(snapshot.size)
+		, reserved(nullptr)
+		, reserved_size(0)
+#ifdef _WIN32
+		, upper(nullptr)
+		, view(false)
+#endif
+	{
+		allocate(&snapshot);
+	}
+
+	A256Memory(const A256Memory&) = delete;
+	A256Memory& operator =(const A256Memory&) = delete;
+
+	~A256Memory()
+	{
+		release();
+	}
+
+	void allocate(const A256Snapshot* snapshot) // aligned region between guard areas, committed or mapped from snapshot
+	{
+#ifdef _WIN32
+		for (u32 attempt = 0; attempt < 16 && !base; attempt++)
+		{
+			// find aligned address, then reserve it again (other thread may take it in between)
+			u8* p = (u8*)VirtualAlloc(nullptr, size * 2 + guard * 2, MEM_RESERVE, PAGE_NOACCESS);
+			if (!p)
+			{
+				break;
+			}
+			u8* aligned = (u8*)(((u64)p + guard + size - 1) & ~(size - 1));
+			VirtualFree(p, 0, MEM_RELEASE);
+			reserved = (u8*)VirtualAlloc(aligned - guard, guard, MEM_RESERVE, PAGE_NOACCESS);
+			if (snapshot)
+			{
+				base = (u8*)MapViewOfFileEx(snapshot->section, FILE_MAP_COPY, 0, 0, size, aligned);
+				view = base != nullptr;
+			}
+			else
+			{
+				base = (u8*)VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			}
+			upper = (u8*)VirtualAlloc(aligned + size, guard, MEM_RESERVE, PAGE_NOACCESS);
+			if (reserved && base && upper && VirtualAlloc(upper, page, MEM_COMMIT, PAGE_READWRITE))
+			{
+				reserved_size = guard;
+				break;
+			}
+			release();
+		}
+#else
+		reserved_size = size * 2 + guard * 2;
+		reserved = (u8*)mmap(nullptr, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (reserved == MAP_FAILED)
+		{
+			reserved = nullptr;
+		}
+		else
+		{
+			u8* aligned = (u8*)(((u64)reserved + guard + size - 1) & ~(size - 1));
+			if (snapshot ?
+				mmap(aligned, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, snapshot->file, 0) != MAP_FAILED && !mprotect(aligned + size, page, PROT_READ | PROT_WRITE) :
+				!mprotect(aligned, size + page, PROT_READ | PROT_WRITE))
+			{
+				base = aligned;
+			}
+		}
+#endif
+		if (!base)
+		{
+			release();
+			throw fmt::format(__FUNCTION__"(): memory allocation failed (0x%llx bytes).", size);
+		}
+	}
+
+	void swap(A256Memory& other)
+	{
+		std::swap(base, other.base);
+		std::swap(size, other.size);
+		std::swap(reserved, other.reserved);
+		std::swap(reserved_size, other.reserved_size);
+#ifdef _WIN32
+		std::swap(upper, other.upper);
+		std::swap(view, other.view);
+#endif
+	}
+
+	void release()
+	{
+#ifdef _WIN32
+		if (base)
+		{
+			if (view)
+			{
+				UnmapViewOfFile(base);
+			}
+			else
+			{
+				VirtualFree(base, 0, MEM_RELEASE);
+			}
+			base = nullptr;
+			view = false;
+		}
+		if (upper)
+		{
+			VirtualFree(upper, 0, MEM_RELEASE);
+			upper = nullptr;
+		}
+#endif
+		if (reserved)
+		{
+#ifdef _WIN32
+			VirtualFree(reserved, 0, MEM_RELEASE);
+#else
+			munmap(reserved, reserved_size);
+#endif
+			reserved = nullptr;
+		}
+	}
+
+	void attach(A256Machine& vm) const
+	{
+		vm.mem_base = (u64)base;
+		vm.mem_mask = size - 1;
+	}
+
+	static void detach(A256Machine& vm)
+	{
+		vm.mem_base = 0;
+		vm.mem_mask = ~0ull;
+	}
+
+	A256Machine::A256Threaded load(A256Machine& vm, const std::vector<A256Cmd>& program, u64 stack_size = 0x10000, u64 cstack_size = 0x1000)
+	{
+		return load(vm, program.data(), program.size(), stack_size, cstack_size);
+	}
+
+	A256Machine::A256Threaded load(A256Machine& vm, const A256Cmd* program, size_t count, u64 stack_size = 0x10000, u64 cstack_size = 0x1000)
+	{
+		const u64 code_size = count * sizeof(A256Cmd);
+		if (code_size > size || stack_size + cstack_size > size - code_size)
+		{
+			throw fmt::format(__FUNCTION__"(): program and stacks don't fit (0x%llx bytes).", size);
+		}
+		memcpy(base, program, code_size);
+		attach(vm);
+		vm.reg[0]._uq[0] = (u64)base; // $NP
+		vm.reg[0]._uq[1] = (u64)base + size; // $CS
+		vm.reg[0]._uq[2] = (u64)base + size - cstack_size; // $BP
+		vm.reg[0]._uq[3] = vm.reg[0]._uq[2]; // $SP
+		return vm.decode((const A256Cmd*)base, count);
+	}
+
+	void fork(A256Machine& vm, const A256Snapshot& snapshot) // replace region with copy-on-write view of snapshot, restore registers and attach
+	{
+		if (snapshot.size != size)
+		{
+			throw fmt::format(__FUNCTION__"(): snapshot size 0x%llx doesn't match (0x%llx bytes).", snapshot.size, size);
+		}
+		A256Memory copy(snapshot); // new address, this region stays intact if it throws
+		swap(copy);
+		memcpy(vm.reg, snapshot.reg, sizeof(vm.reg));
+		vm.exit_status = snapshot.exit_status;
+		attach(vm);
+	}
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "A256Def.h"
+
+// execution profile (built only with A256_PROFILE defined, see A256Machine::step())
+
+/*
+1) counts executions and rdtsc cycles per opcode (16-bit cmd) and per instruction of pre-decoded program
+2) instructions executed outside of pre-decoded program are counted per opcode only
+3) cycles include the handler call and measurement overhead, compare them relatively
+4) native blocks of A256Jit are not profiled, the whole program is interpreted
+5) pairs and triples of instructions (opcode and selector kinds of the specialized handler) are counted
+   when executed one after another in program order (not across taken jumps),
+   fusions() turns the most frequent ones into superinstructions (see A256Fused.h)
+*/
+
+struct A256Profile
+{
+	struct A256Counter
+	{
+		u64 count;
+		u64 cycles;
+	};
+
+	std::vector<A256Counter> ops; // indexed by cmd
+	std::vector<A256Counter> pos; // indexed by instruction of pre-decoded program
+	std::unordered_map<u64, u64> pairs; // part1 << 20 | part2 -> count, part: cmd | kinds << 16 (see sequence())
+	std::unordered_map<u64, u64> triples; // part1 << 40 | part2 << 20 | part3 -> count
+	u64 next; // address after the last instruction
+	u32 last[2]; // parts of the last two instructions (newest first)
+	u32 depth; // how many of them precede the next instruction in program order
+
+	A256Profile()
+		: ops(0x10000)
+		, next(0)
+		, depth(0)
+	{
+	}
+
+	void reset()
+	{
+		ops.assign(0x10000, A256Counter());
+		pos.clear();
+		pairs.clear();
+		triples.clear();
+		depth = 0;
+	}
+
+	void sequence(u64 np, u32 part) // count sequences ending with instruction at np, kinds: selectors of specialized handler (see A256Machine::kinds())
+	{
+		if (np != next)
+		{
+			depth = 0;
+		}
+		if (depth > 0)
+		{
+			pairs[(u64)last[0] << 20 | part]++;
+		}
+		if (depth > 1)
+		{
+			triples[(u64)last[1] << 40 | (u64)last[0] << 20 | part]++;
+		}
+		last[1] = last[0];
+		last[0] = part;
+		depth = std::min<u32>(depth + 1, 2);
+		next = np + sizeof(A256Cmd);
+	}
+
+	void merge(const A256Profile& other) // add counters of another machine (e.g. batch worker)
+	{
+		for (size_t i = 0; i < ops.size(); i++)
+		{
+			ops[i].count += other.ops[i].count;
+			ops[i].cycles += other.ops[i].cycles;
+		}
+		if (pos.size() < other.pos.size())
+		{
+			pos.resize(other.pos.size());
+		}
+		for (size_t i = 0; i < other.pos.size(); i++)
+		{
+			pos[i].count += other.pos[i].count;
+			pos[i].cycles += other.pos[i].cycles;
+		}
+		for (const auto& p : other.pairs)
+		{
+			pairs[p.first] += p.second;
+		}
+		for (const auto& t : other.triples)
+		{
+			triples[t.first] += t.second;
+		}
+	}
+
+	template<typename T>
+	std::string fusions(const T& instr, size_t top = 8, u32 code = 0x0160) const // A256Fused.h for the sequences saving most dispatches
+	{
+		struct A256Candidate
+		{
+			u32 length;
+			u32 seq[3]; // parts
+			u64 count;
+			u64 covered; // dispatches already saved by chosen candidates
+		};
+
+		u64 total = 0;
+		for (const auto& c : ops)
+		{
+			total += c.count;
+		}
+		const auto fusible = [&instr](u32 part) { return instr.name[part & 0xffff] && !strchr(instr.name[part & 0xffff], '+'); }; // registered, not fused already
+		std::vector<A256Candidate> list;
+		for (const auto& p : pairs)
+		{
+			const A256Candidate c = { 2, { (u32)(p.first >> 20), (u32)p.first & 0xfffff, 0 }, p.second, 0 };
+			if (fusible(c.seq[0]) && fusible(c.seq[1])) list.push_back(c);
+		}
+		for (const auto& t : triples)
+		{
+			const A256Candidate c = { 3, { (u32)(t.first >> 40), (u32)(t.first >> 20) & 0xfffff, (u32)t.first & 0xfffff }, t.second, 0 };
+			if (fusible(c.seq[0]) && fusible(c.seq[1]) && fusible(c.seq[2])) list.push_back(c);
+		}
+
+		// name with selector kinds (f: full, i: immediate, l: lane), generic handler and the handler actually called
+		const auto name = [&instr](u32 part)
+		{
+			const u32 kinds = part >> 16;
+			return kinds ? fmt::format("%s.%c%c", instr.name[part & 0xffff], "fil"[(kinds - 1) / 3], "fil"[(kinds - 1) % 3]) : std::string(instr.name[part & 0xffff]);
+		};
+		const auto args = [&instr](u32 part)
+		{
+			static const char* const kind[] = { "bscFull", "bscImm", "bscLane" };
+			const u32 kinds = part >> 16;
+			const char* const generic = instr.name[part & 0xffff];
+			return kinds ? fmt::format("%s, (%s, %s, %s>)", generic, instr.variant_name[instr.spec[part & 0xffff]], kind[(kinds - 1) / 3], kind[(kinds - 1) % 3])
+				: fmt::format("%s, (%s)", generic, generic);
+		};
+
+		std::string res = fmt::format("// generated by A256Profile::fusions() from %llu instructions\n", total);
+		for (size_t n = 0; n < top && !list.empty(); n++)
+		{
+			// greedy: dispatches saved in addition to the chosen candidates (pair inside triple, triple extending pair)
+			const auto saved = [](const A256Candidate& c) { return c.count * (c.length - 1) - c.covered; };
+			size_t best = 0;
+			for (size_t i = 1; i < list.size(); i++)
+			{
+				const u64 a = saved(list[i]);
+				const u64 b = saved(list[best]);
+				if (a > b || (a == b && std::lexicographical_compare(list[i].seq, list[i].seq + 3, list[best].seq, list[best].seq + 3)))
+				{
+					best = i;
+				}
+			}
+			const A256Candidate c = list[best];
+			list.erase(list.begin() + best);
+			if (!saved(c))
+			{
+				break;
+			}
+			std::string line = fmt::format("FUSE%u(0x%.4x, \"%s", c.length, code++, name(c.seq[0]).c_str());
+			for (u32 k = 1; k < c.length; k++)
+			{
+				line += "+" + name(c.seq[k]);
+			}
+			line += "\"";
+			for (u32 k = 0; k < c.length; k++)
+			{
+				line += ", " + args(c.seq[k]);
+			}
+			res += line + fmt::format("); // %.2f%% of dispatches\n", saved(c) * 100.0 / total);
+			for (auto& o : list)
+			{
+				if (o.length == c.length)
+				{
+					continue;
+				}
+				const A256Candidate& pair = c.length == 2 ? c : o;
+				const A256Candidate& triple = c.length == 2 ? o : c;
+				if ((pair.seq[0] == triple.seq[0] && pair.seq[1] == triple.seq[1]) || (pair.seq[0] == triple.seq[1] && pair.seq[1] == triple.seq[2]))
+				{
+					o.covered = std::min(o.covered + std::min(pair.count, triple.count), o.count * (o.length - 1));
+				}
+			}
+		}
+		return res;
+	}
+
+	void report(char* const* names, const A256Cmd* program, const std::string& text, const std::vector<u64>& lines, size_t top = 20) const // sorted by cycles
+	{
+		u64 count = 0;
+		u64 cycles = 0;
+		std::vector<u32> order;
+		for (u32 i = 0; i < ops.size(); i++)
+		{
+			if (ops[i].count)
+			{
+				count += ops[i].count;
+				cycles += ops[i].cycles;
+				order.push_back(i);
+			}
+		}
+		const auto by_cycles = [](const std::vector<A256Counter>& c)
+		{
+			return [&c](size_t a, size_t b){ return c[a].cycles != c[b].cycles ? c[a].cycles > c[b].cycles : a < b; };
+		};
+		std::sort(order.begin(), order.end(), by_cycles(ops));
+
+		printf("Profile: %llu instructions, %llu cycles\n", count, cycles);
+		printf("opcode name       count              cycles     cyc/op  cycles%%\n");
+		for (u32 i : order)
+		{
+			printf("0x%.4x %-10s %-18llu %-10llu %6.1f %7.2f\n", i, names[i] ? names[i] : "?",
+				ops[i].count, ops[i].cycles, (double)ops[i].cycles / ops[i].count, cycles ? ops[i].cycles * 100.0 / cycles : 0.0);
+		}
+
+		std::vector<size_t> hot;
+		for (size_t i = 0; i < pos.size(); i++)
+		{
+			if (pos[i].count)
+			{
+				hot.push_back(i);
+			}
+		}
+		std::sort(hot.begin(), hot.end(), by_cycles(pos));
+		hot.resize(std::min(hot.size(), top));
+
+		printf("Hot instructions:\n");
+		printf("position line   count              cycles     cycles%%  source\n");
+		for (size_t i : hot)
+		{
+			std::string source;
+			if (i < lines.size())
+			{
+				// find text of source line
+				size_t start = 0;
+				for (u64 l = 1; l < lines[i] && start != std::string::npos; l++)
+				{
+					start = text.find('\n', start);
+					start = start == std::string::npos ? start : start + 1;
+				}
+				if (start != std::string::npos)
+				{
+					source = text.substr(start, text.find_first_of("\r\n", start) - start);
+				}
+			}
+			else
+			{
+				source = names[program[i].cmd] ? names[program[i].cmd] : "?";
+			}
+			printf("%-8llu %-6llu %-18llu %-10llu %7.2f  %s\n", (u64)i, i < lines.size() ? lines[i] : 0,
+				pos[i].count, pos[i].cycles, cycles ? pos[i].cycles * 100.0 / cycles : 0.0, source.c_str());
+		}
+	}
+};
@@ -9,10 +9,13 @@
 2) "packing" means, selected fragment is broadcasted as is, with no conversion
 3) "saturation" means, conversion to operating type where values exceeding bounds are set to those bounds
 4) "convert" means, source or destination is interleaved with zero values (depends on sizes)
+5) rounding modes (@@): 00 - round (half away from zero), 01 - truncate, 10 - floor, 11 - ceil
 000 ##### - select _ub[] with saturation ($00.ub0 .. $FF.ub31)
 001 ##### - select _sb[] with saturation ($00.sb0 .. $FF.sb31)
 0100 #### - select _uw[] with packing ($00.uw0 .. $FF.uw15, $00.sw0 .. $FF.sw15)
-0101 #### - not used
+01010 0 @@ - convert from single with rounding and saturation ($00.getfsr, $00.getfst, $00.getfsf, $00.getfsc)
+01010 1 @@ - convert from double with rounding and saturation ($00.getfdr, $00.getfdt, $00.getfdf, $00.getfdc)
+01011 ### - not used
 0110 #### - select _uw[] with saturation ($00.uws0 .. $FF.uws15)
 0111 #### - select _sw[] with saturation ($00.sws0 .. $FF.sws15)
 10000 ### - select _ud[] with packing ($00.ud0 .. $FF.ud7, $00.sd0 .. $FF.sd7, $00.fs0 .. $FF.fs7)
@@ -72,6 +75,9 @@ aabbccrr: 2 bit for each argument (a, b, c and result)
 11: neg(abs()): set sign to negative (negabs, $FF.negabs)
 */
 
+template<typename Tin, typename Tout>
+struct A256Convert; // conversion kernels (see A256Simd.h)
+
 // 256-bit register struct
 union A256Reg
 {
@@ -128,6 +134,59 @@ union A256Reg
 		return res;
 	}
 
+	static void lanes(u32 mask, __m128i& sel_lo, __m128i& sel_hi) // expand 8-bit mask to dword lanes (all ones if selected)
+	{
+		const __m128i bits_lo = _mm_set_epi32(0x08, 0x04, 0x02, 0x01);
+		const __m128i bits_hi = _mm_set_epi32(0x80, 0x40, 0x20, 0x10);
+		const __m128i m = _mm_set1_epi32(mask);
+		sel_lo = _mm_cmpeq_epi32(_mm_and_si128(m, bits_lo), bits_lo);
+		sel_hi = _mm_cmpeq_epi32(_mm_and_si128(m, bits_hi), bits_hi);
+	}
+
+	void save(const A256Reg& data, u32 mask) // write dwords of data selected by 8-bit mask to register (see RSAVE1)
+	{
+		if ((mask & 0xff) == 0xff)
+		{
+			*this = data;
+			return;
+		}
+		// blend, no branch per lane (reads and writes all 32 bytes, so not for memory)
+		__m128i sel_lo, sel_hi;
+		lanes(mask, sel_lo, sel_hi);
+#if defined(__AVX2__)
+		const __m256i sel = _mm256_inserti128_si256(_mm256_castsi128_si256(sel_lo), sel_hi, 1);
+		_mm256_storeu_si256(&_qq, _mm256_blendv_epi8(_mm256_loadu_si256(&_qq), _mm256_loadu_si256(&data._qq), sel));
+#elif defined(__AVX__)
+		const __m256 sel = _mm256_castsi256_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(sel_lo), sel_hi, 1));
+		_mm256_storeu_ps(_fs, _mm256_blendv_ps(_mm256_loadu_ps(_fs), _mm256_loadu_ps(data._fs), sel));
+#else
+		_mm_storeu_si128(&_dq[0], _mm_or_si128(_mm_and_si128(sel_lo, _mm_loadu_si128(&data._dq[0])), _mm_andnot_si128(sel_lo, _mm_loadu_si128(&_dq[0]))));
+		_mm_storeu_si128(&_dq[1], _mm_or_si128(_mm_and_si128(sel_hi, _mm_loadu_si128(&data._dq[1])), _mm_andnot_si128(sel_hi, _mm_loadu_si128(&_dq[1]))));
+#endif
+	}
+
+	void store(const A256Reg& data, u32 mask) // write dwords of data selected by 8-bit mask to memory, other dwords are not accessed (see RSTORE1)
+	{
+		if ((mask & 0xff) == 0xff)
+		{
+			*this = data;
+			return;
+		}
+#if defined(__AVX__)
+		__m128i sel_lo, sel_hi;
+		lanes(mask, sel_lo, sel_hi);
+		_mm256_maskstore_ps(_fs, _mm256_insertf128_si256(_mm256_castsi128_si256(sel_lo), sel_hi, 1), _mm256_loadu_ps(data._fs));
+#else
+		for (u32 i = 0; i < 8; i++)
+		{
+			if (mask & (1 << i))
+			{
+				_ud[i] = data._ud[i];
+			}
+		}
+#endif
+	}
+
 	template<typename T>
 	T& get(u32 index)
 	{
@@ -176,7 +235,7 @@ union A256Reg
 			// float input/output
 			if (in_float && !out_float)
 			{
-				out = (in < (Tin)out_min) ? out_min : ((Tin)out_max < in) ? out_max : (Tout)in;
+				out = (in != in) ? 0 : (in <= (Tin)out_min) ? out_min : ((Tin)out_max <= in) ? out_max : (Tout)in; // NaN is 0
 			}
 			else
 			{
@@ -231,23 +290,126 @@ union A256Reg
 	}
 
 	template<typename Tin, typename Tout>
-	void convert(A256Reg* data)
+	void convert(A256Reg* data) // bsc1 conversion (Tin and Tout are interleaved with zero values if sizes differ)
+	{
+		*this = A256Convert<Tin, Tout>::convert(*data);
+	}
+
+	template<typename T>
+	static T imm(u8 code, u8 regnum) // immediate value of bsc1 codes 0xfa .. 0xfd
+	{
+		static const s64 base[4] = { 256, -512, 0, -256 }; // 0xfc, 0xfd, 0xfa, 0xfb
+		return (T)(base[code & 3] + regnum);
+	}
+
+#ifdef __AVX__
+	static __m128 round_ps(__m128 x, u32 mode) // see rounding modes (@@)
+	{
+		switch (mode)
+		{
+		case 1: return _mm_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		case 2: return _mm_round_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+		case 3: return _mm_round_ps(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+		}
+		// no such rounding mode: truncate, then add 1 with the sign of x if the dropped fraction is at least 0.5
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 t = _mm_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		const __m128 half = _mm_cmpge_ps(_mm_andnot_ps(sign, _mm_sub_ps(x, t)), _mm_set1_ps(0.5f));
+		return _mm_blendv_ps(t, _mm_add_ps(t, _mm_or_ps(_mm_and_ps(x, sign), _mm_set1_ps(1.0f))), half); // keep -0
+	}
+
+	static __m128d round_pd(__m128d x, u32 mode)
 	{
-		if (sizeof(Tout) > sizeof(Tin))
+		switch (mode)
 		{
-			for (u32 i = 0; i < 32 / sizeof(Tout); i++)
+		case 1: return _mm_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		case 2: return _mm_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+		case 3: return _mm_round_pd(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+		}
+		const __m128d sign = _mm_set1_pd(-0.0);
+		const __m128d t = _mm_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		const __m128d half = _mm_cmpge_pd(_mm_andnot_pd(sign, _mm_sub_pd(x, t)), _mm_set1_pd(0.5));
+		return _mm_blendv_pd(t, _mm_add_pd(t, _mm_or_pd(_mm_and_pd(x, sign), _mm_set1_pd(1.0))), half);
+	}
+#endif
+
+	static f32 round_lane(f32 x, u32 mode)
+	{
+#ifdef __AVX__
+		return _mm_cvtss_f32(round_ps(_mm_set_ss(x), mode));
+#else
+		switch (mode)
+		{
+		case 1: return trunc(x);
+		case 2: return floor(x);
+		case 3: return ceil(x);
+		}
+		return round(x);
+#endif
+	}
+
+	static f64 round_lane(f64 x, u32 mode)
+	{
+#ifdef __AVX__
+		return _mm_cvtsd_f64(round_pd(_mm_set_sd(x), mode));
+#else
+		switch (mode)
+		{
+		case 1: return trunc(x);
+		case 2: return floor(x);
+		case 3: return ceil(x);
+		}
+		return round(x);
+#endif
+	}
+
+	A256Reg round_all(u8 code) // round all singles or doubles (bsc1 codes 0x50 .. 0x57)
+	{
+		A256Reg res;
+#ifdef __AVX__
+		for (u32 i = 0; i < 2; i++)
+		{
+			if (code & 4)
+			{
+				_mm_storeu_pd(&res._fd[i * 2], round_pd(_mm_loadu_pd(&_fd[i * 2]), code & 3));
+			}
+			else
+			{
+				_mm_storeu_ps(&res._fs[i * 4], round_ps(_mm_loadu_ps(&_fs[i * 4]), code & 3));
+			}
+		}
+#else
+		if (code & 4)
+		{
+			for (u32 i = 0; i < 4; i++)
 			{
-				saturate<Tout, Tin>(*(((Tout*)this) + i), *(Tin*)(((Tout*)data) + i));
+				res._fd[i] = round_lane(_fd[i], code & 3);
 			}
 		}
 		else
 		{
-			for (u32 i = 0; i < 32 / sizeof(Tin); i++)
+			for (u32 i = 0; i < 8; i++)
 			{
-				*(Tout*)(((Tin*)this) + i) = 0;
-				saturate<Tout, Tin>(*(Tout*)(((Tin*)this) + i), *(((Tin*)this) + i));
+				res._fs[i] = round_lane(_fs[i], code & 3);
 			}
 		}
+#endif
+		return res;
+	}
+
+	A256Reg lane(u8 code) // bsc1 packing: broadcast word, dword, qword or dqword
+	{
+		switch (code >> 6)
+		{
+		case 1: return set(_uw[code % 16]);
+		case 2: return set(_ud[code % 8]);
+		default: return (code & 0x20) ? set(_dq[code % 2]) : set(_uq[code % 4]);
+		}
+	}
+
+	static bool bsc1_valid(u8 code) // codes 0x58 .. 0x5f are reserved, instructions using them are rejected by A256Machine::handler()
+	{
+		return (code & 0xf8) != 0x58;
 	}
 
 	template<typename T>
@@ -269,11 +431,24 @@ union A256Reg
 			res.fill(sel);
 			break;
 		}
-		case 2: // select (...) word with packing
+		case 2: // select (...) word with packing or convert with rounding
 		{
-			if (code & 0x10)
+			if ((code & 0x18) == 0x10) // all singles or doubles
+			{
+				A256Reg data = round_all(code);
+				if (code & 4)
+				{
+					res.convert<f64, T>(&data);
+				}
+				else
+				{
+					res.convert<f32, T>(&data);
+				}
+				break;
+			}
+			if (code & 0x10) // reserved (see bsc1_valid())
 			{
-				throw fmt::format("Unsupported bsc1 encoding");
+				return set<u64>(0);
 			}
 			res.fill(_uw[code % 16]); // packing
 			break;
@@ -318,59 +493,17 @@ union A256Reg
 			}
 			break;
 		}
-		case 5: // select single precision float
+		case 5: // select single precision float with rounding
 		{
-			if (code & 0x10)
-			{
-				if (code & 8)
-				{
-					saturate(sel, trunc(_fs[code % 8]));
-				}
-				else
-				{
-					saturate(sel, ceil(_fs[code % 8]));
-				}
-			}
-			else
-			{
-				if (code & 8)
-				{
-					saturate(sel, floor(_fs[code % 8]));
-				}
-				else
-				{
-					saturate(sel, round(_fs[code % 8]));
-				}
-			}
+			saturate(sel, round_lane(_fs[code % 8], (code >> 3) & 3));
 			res.fill(sel);
 			break;
 		}
 		case 6: // select (...) qword (...) or double precision float
 		{
-			if (code & 0x10) // double
+			if (code & 0x10) // double with rounding
 			{
-				if (code & 8)
-				{
-					if (code & 4)
-					{
-						saturate(sel, trunc(_fd[code % 4]));
-					}
-					else
-					{
-						saturate(sel, ceil(_fd[code % 4]));
-					}
-				}
-				else
-				{
-					if (code & 4)
-					{
-						saturate(sel, floor(_fd[code % 4]));
-					}
-					else
-					{
-						saturate(sel, round(_fd[code % 4]));
-					}
-				}
+				saturate(sel, round_lane(_fd[code % 4], (code >> 2) & 3));
 				res.fill(sel);
 			}
 			else
@@ -535,27 +668,11 @@ union A256Reg
 			break;
 		}
 		case 0x1a:
-		{
-			sel = (T)regnum;
-			res.fill(sel);
-			break;
-		}
 		case 0x1b:
-		{
-			sel = (T)(~0ull & regnum);
-			res.fill(sel);
-			break;
-		}
 		case 0x1c:
-		{
-			sel = (T)(256ull + regnum);
-			res.fill(sel);
-			break;
-		}
 		case 0x1d:
 		{
-			sel = (T)(~256ull & regnum);
-			res.fill(sel);
+			res.fill(imm<T>(code, regnum));
 			break;
 		}
 		case 0x1e:
@@ -587,7 +704,7 @@ union A256Reg
 		{
 			for (u32 i = 0; i < 32 / sizeof(T); i++)
 			{
-				T& data = get<T>(i);
+				T& data = res.get<T>(i);
 				data = abs(data);
 			}
 		}
@@ -595,7 +712,7 @@ union A256Reg
 		{
 			for (u32 i = 0; i < 32 / sizeof(T); i++)
 			{
-				T& data = get<T>(i);
+				T& data = res.get<T>(i);
 				data = (T)0 - data;
 			}
 		}
@@ -636,6 +753,15 @@ struct A256Cmd
 			u8 b_mask; // special info
 		} op3;
 
+		struct A256Op2Imm16 // 2 regs + immediate (a and b as in A256Op3)
+		{
+			s16 imm; // data (for example, relative jump)
+			u8 a;
+			u8 a_mask;
+			u8 b;
+			u8 b_mask;
+		} op2j;
+
 		struct A256Op4 // 4 regs
 		{
 			u8 r;
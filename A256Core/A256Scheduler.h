@@ -0,0 +1,164 @@
+#pragma once
+
+#include "A256Jit.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
+// cooperative time-slicing of many machines on a few threads
+
+/*
+1) every task is a machine prepared by the caller (registers, stacks, guest space) with its pre-decoded program
+2) worker threads take tasks from one FIFO queue and run them for one slice (run() with budget = slice instructions)
+3) task that used its slice goes to the back of the queue, so every runnable task gets one slice per round
+4) task leaves the queue on exit (stop 0), fault or exception; status and error describe the reason
+5) machines keep their state between slices (see A256Machine::yield()), output is flushed only when task finishes
+6) with A256Jit, native loops check the budget on every pass and a slice may be exceeded by one block
+7) add() may be called from any thread at any time, wait() returns when no task is queued or running
+*/
+
+struct A256Scheduler
+{
+	struct A256Task
+	{
+		A256Machine* vm;
+		const A256Machine::A256Threaded* program;
+		A256Jit* jit; // optional translation of program
+		u32 status; // A256Fault of the last slice (faultBudget while runnable)
+		u64 slices; // slices executed
+		std::string error; // fault message or exception, empty if finished normally
+	};
+
+	std::vector<std::unique_ptr<A256Task>> tasks; // indexed by add() result
+	std::deque<A256Task*> ready; // runnable tasks, oldest first
+	std::vector<std::thread> threads;
+	std::mutex lock; // protects tasks, ready, running and quit
+	std::condition_variable ready_cv;
+	std::condition_variable done_cv;
+	size_t running; // tasks taken from the queue by workers
+	u64 slice; // instructions per slice
+	bool quit;
+
+	A256Scheduler(u32 thread_count = std::thread::hardware_concurrency(), u64 slice = 0x10000)
+		: running(0)
+		, slice(std::max<u64>(slice, 1))
+		, quit(false)
+	{
+		thread_count = std::max<u32>(thread_count, 1);
+		for (u32 i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back(&A256Scheduler::work, this);
+		}
+	}
+
+	A256Scheduler(const A256Scheduler&) = delete;
+	A256Scheduler& operator =(const A256Scheduler&) = delete;
+
+	~A256Scheduler() // queued tasks are abandoned, running slices are finished
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			quit = true;
+		}
+		ready_cv.notify_all();
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+	}
+
+	size_t add(A256Machine& vm, const A256Machine::A256Threaded& program, A256Jit* jit = nullptr) // start task, returns its index
+	{
+		std::unique_ptr<A256Task> task(new A256Task);
+		task->vm = &vm;
+		task->program = &program;
+		task->jit = jit;
+		task->status = A256Machine::faultBudget;
+		task->slices = 0;
+
+		std::lock_guard<std::mutex> l(lock);
+		ready.push_back(task.get());
+		tasks.push_back(std::move(task));
+		ready_cv.notify_one();
+		return tasks.size() - 1;
+	}
+
+	void wait() // until all tasks are finished, then task() results are stable
+	{
+		std::unique_lock<std::mutex> l(lock);
+		done_cv.wait(l, [&]{ return ready.empty() && running == 0; });
+	}
+
+	const A256Task& task(size_t index)
+	{
+		std::lock_guard<std::mutex> l(lock);
+		return *tasks[index];
+	}
+
+	void work()
+	{
+		A256Task* task = nullptr;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> l(lock);
+				if (task)
+				{
+					running--;
+					if (task->status == A256Machine::faultBudget)
+					{
+						ready.push_back(task);
+					}
+					else if (ready.empty() && running == 0)
+					{
+						done_cv.notify_all();
+					}
+				}
+				ready_cv.wait(l, [&]{ return quit || !ready.empty(); });
+				if (quit)
+				{
+					return;
+				}
+				task = ready.front();
+				ready.pop_front();
+				running++;
+			}
+			execute(*task);
+		}
+	}
+
+	void execute(A256Task& task) // run one slice
+	{
+		A256Machine& vm = *task.vm;
+		try
+		{
+			task.status = task.jit ? task.jit->run(vm, slice) : vm.run(*task.program, slice);
+			if (task.status != A256Machine::faultNone && task.status != A256Machine::faultBudget)
+			{
+				task.error = vm.fault_message();
+			}
+		}
+		catch (std::string& x)
+		{
+			task.status = A256Machine::faultNone;
+			task.error = x;
+		}
+		catch (std::exception& x)
+		{
+			task.status = A256Machine::faultNone;
+			task.error = x.what();
+		}
+		catch (...)
+		{
+			task.status = A256Machine::faultNone;
+			task.error = "unknown error";
+		}
+		if (task.status != A256Machine::faultBudget)
+		{
+			vm.flush();
+		}
+		task.slices++;
+	}
+};
@@ -0,0 +1,1664 @@
+#pragma once
+
+#include "A256Reg.h"
+#include <immintrin.h>
+
+// element-wise arithmetic kernels
+
+/*
+1) A256Lanes<T> processes one element at a time (reference implementation)
+2) A256Simd<T> computes the same result with SSE2, or with AVX/AVX2 if enabled at compile time
+3) registers are packed, so all loads and stores are unaligned
+4) types without vector kernel fall back to A256Lanes<T>
+5) A256Convert<Tin, Tout> is the same for bsc1 conversions (reference implementation is A256ConvertLanes<Tin, Tout>)
+*/
+
+template<typename T>
+T lane_mulh(T a, T b) // high part of product
+{
+	return std::numeric_limits<T>::is_signed
+		? (T)(((s64)a * (s64)b) >> (sizeof(T) * 8))
+		: (T)(((u64)a * (u64)b) >> (sizeof(T) * 8));
+}
+
+inline s64 lane_mulh(s64 a, s64 b)
+{
+	return __mulh(a, b);
+}
+
+inline u64 lane_mulh(u64 a, u64 b)
+{
+	return __umulh(a, b);
+}
+
+template<typename T>
+struct A256Lanes
+{
+	static A256Reg add(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = (a.get<T>(i)) + (b.get<T>(i));
+		}
+		return res;
+	}
+
+	static A256Reg sub(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = (a.get<T>(i)) - (b.get<T>(i));
+		}
+		return res;
+	}
+
+	static A256Reg mul(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = (a.get<T>(i)) * (b.get<T>(i));
+		}
+		return res;
+	}
+
+	static A256Reg mulh(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = lane_mulh(a.get<T>(i), b.get<T>(i));
+		}
+		return res;
+	}
+
+	static A256Reg ceq(A256Reg& a, A256Reg& b) // all bits of element set if true
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			memset(&res.get<T>(i), (a.get<T>(i)) == (b.get<T>(i)) ? 0xff : 0, sizeof(T));
+		}
+		return res;
+	}
+
+	static A256Reg cgt(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			memset(&res.get<T>(i), (a.get<T>(i)) > (b.get<T>(i)) ? 0xff : 0, sizeof(T));
+		}
+		return res;
+	}
+
+	static A256Reg min(A256Reg& a, A256Reg& b) // a < b ? a : b (b if unordered, like minps)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = (a.get<T>(i)) < (b.get<T>(i)) ? a.get<T>(i) : b.get<T>(i);
+		}
+		return res;
+	}
+
+	static A256Reg max(A256Reg& a, A256Reg& b) // a > b ? a : b
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			res.get<T>(i) = (a.get<T>(i)) > (b.get<T>(i)) ? a.get<T>(i) : b.get<T>(i);
+		}
+		return res;
+	}
+};
+
+struct A256Vec // load/store helpers
+{
+	static __m128i vi(A256Reg& r, u32 half)
+	{
+		return _mm_loadu_si128(&r._dq[half]);
+	}
+
+	static __m128 vs(A256Reg& r, u32 half)
+	{
+		return _mm_loadu_ps(&r._fs[half * 4]);
+	}
+
+	static __m128d vd(A256Reg& r, u32 half)
+	{
+		return _mm_loadu_pd(&r._fd[half * 2]);
+	}
+
+	static A256Reg ret(__m128i lo, __m128i hi)
+	{
+		A256Reg res;
+		_mm_storeu_si128(&res._dq[0], lo);
+		_mm_storeu_si128(&res._dq[1], hi);
+		return res;
+	}
+
+	static A256Reg ret(__m128 lo, __m128 hi)
+	{
+		A256Reg res;
+		_mm_storeu_ps(&res._fs[0], lo);
+		_mm_storeu_ps(&res._fs[4], hi);
+		return res;
+	}
+
+	static A256Reg ret(__m128d lo, __m128d hi)
+	{
+		A256Reg res;
+		_mm_storeu_pd(&res._fd[0], lo);
+		_mm_storeu_pd(&res._fd[2], hi);
+		return res;
+	}
+
+#ifdef __AVX__
+	static __m256 vs(A256Reg& r)
+	{
+		return _mm256_loadu_ps(r._fs);
+	}
+
+	static __m256d vd(A256Reg& r)
+	{
+		return _mm256_loadu_pd(r._fd);
+	}
+
+	static A256Reg ret(__m256 v)
+	{
+		A256Reg res;
+		_mm256_storeu_ps(res._fs, v);
+		return res;
+	}
+
+	static A256Reg ret(__m256d v)
+	{
+		A256Reg res;
+		_mm256_storeu_pd(res._fd, v);
+		return res;
+	}
+#endif
+
+#ifdef __AVX2__
+	static __m256i vi(A256Reg& r)
+	{
+		return _mm256_loadu_si256(&r._qq);
+	}
+
+	static A256Reg ret(__m256i v)
+	{
+		A256Reg res;
+		_mm256_storeu_si256(&res._qq, v);
+		return res;
+	}
+#endif
+
+	// integer kernels missing in SSE2 (also overloaded for AVX2 below)
+
+	static __m128i mul8(__m128i a, __m128i b) // low byte of product
+	{
+		const __m128i even = _mm_mullo_epi16(a, b);
+		const __m128i odd = _mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+		return _mm_or_si128(_mm_and_si128(even, _mm_set1_epi16(0xff)), _mm_slli_epi16(odd, 8));
+	}
+
+	static __m128i mulhs8(__m128i a, __m128i b)
+	{
+		const __m128i even = _mm_mullo_epi16(_mm_srai_epi16(_mm_slli_epi16(a, 8), 8), _mm_srai_epi16(_mm_slli_epi16(b, 8), 8));
+		const __m128i odd = _mm_mullo_epi16(_mm_srai_epi16(a, 8), _mm_srai_epi16(b, 8));
+		return _mm_or_si128(_mm_srli_epi16(even, 8), _mm_andnot_si128(_mm_set1_epi16(0xff), odd));
+	}
+
+	static __m128i mulhu8(__m128i a, __m128i b)
+	{
+		const __m128i mask = _mm_set1_epi16(0xff);
+		const __m128i even = _mm_mullo_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+		const __m128i odd = _mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+		return _mm_or_si128(_mm_srli_epi16(even, 8), _mm_andnot_si128(mask, odd));
+	}
+
+	static __m128i mul32(__m128i a, __m128i b)
+	{
+#ifdef __AVX__
+		return _mm_mullo_epi32(a, b);
+#else
+		const __m128i even = _mm_mul_epu32(a, b);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+#endif
+	}
+
+	static __m128i mulhu32(__m128i a, __m128i b)
+	{
+		const __m128i even = _mm_mul_epu32(a, b);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+	}
+
+	static __m128i mulhs32(__m128i a, __m128i b) // unsigned high part corrected for negative inputs
+	{
+		const __m128i fix = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b), _mm_and_si128(_mm_srai_epi32(b, 31), a));
+		return _mm_sub_epi32(mulhu32(a, b), fix);
+	}
+
+	static __m128i mul64(__m128i a, __m128i b) // lo * lo + ((hi * lo + lo * hi) << 32)
+	{
+		const __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+		return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+	}
+
+	static __m128i sel(__m128i mask, __m128i a, __m128i b) // mask ? a : b
+	{
+#ifdef __AVX__
+		return _mm_blendv_epi8(b, a, mask);
+#else
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+	}
+
+	static __m128i cgts64(__m128i a, __m128i b)
+	{
+#ifdef __AVX__
+		return _mm_cmpgt_epi64(a, b);
+#else
+		// high dwords greater, or equal and low dwords greater as unsigned
+		const __m128i bias = _mm_set_epi32(0, INT_MIN, 0, INT_MIN);
+		const __m128i x = _mm_xor_si128(a, bias);
+		const __m128i y = _mm_xor_si128(b, bias);
+		const __m128i gt = _mm_cmpgt_epi32(x, y);
+		const __m128i res = _mm_or_si128(gt, _mm_and_si128(_mm_cmpeq_epi32(x, y), _mm_slli_epi64(gt, 32)));
+		return _mm_shuffle_epi32(res, 0xf5);
+#endif
+	}
+
+	static __m128i ceqs64(__m128i a, __m128i b)
+	{
+#ifdef __AVX__
+		return _mm_cmpeq_epi64(a, b);
+#else
+		const __m128i eq = _mm_cmpeq_epi32(a, b);
+		return _mm_and_si128(eq, _mm_shuffle_epi32(eq, 0xb1));
+#endif
+	}
+
+	// unsigned compare: flip sign bits and compare as signed
+	static __m128i cgtu8(__m128i a, __m128i b) { const __m128i s = _mm_set1_epi8(CHAR_MIN); return _mm_cmpgt_epi8(_mm_xor_si128(a, s), _mm_xor_si128(b, s)); }
+	static __m128i cgtu16(__m128i a, __m128i b) { const __m128i s = _mm_set1_epi16(SHRT_MIN); return _mm_cmpgt_epi16(_mm_xor_si128(a, s), _mm_xor_si128(b, s)); }
+	static __m128i cgtu32(__m128i a, __m128i b) { const __m128i s = _mm_set1_epi32(INT_MIN); return _mm_cmpgt_epi32(_mm_xor_si128(a, s), _mm_xor_si128(b, s)); }
+	static __m128i cgtu64(__m128i a, __m128i b) { const __m128i s = _mm_set1_epi64x(LLONG_MIN); return cgts64(_mm_xor_si128(a, s), _mm_xor_si128(b, s)); }
+
+	// min/max missing in SSE2 (SSE4.1 with AVX), 64-bit min/max are always emulated
+#ifdef __AVX__
+	static __m128i mins8(__m128i a, __m128i b) { return _mm_min_epi8(a, b); }
+	static __m128i maxs8(__m128i a, __m128i b) { return _mm_max_epi8(a, b); }
+	static __m128i mins32(__m128i a, __m128i b) { return _mm_min_epi32(a, b); }
+	static __m128i maxs32(__m128i a, __m128i b) { return _mm_max_epi32(a, b); }
+	static __m128i minu16(__m128i a, __m128i b) { return _mm_min_epu16(a, b); }
+	static __m128i maxu16(__m128i a, __m128i b) { return _mm_max_epu16(a, b); }
+	static __m128i minu32(__m128i a, __m128i b) { return _mm_min_epu32(a, b); }
+	static __m128i maxu32(__m128i a, __m128i b) { return _mm_max_epu32(a, b); }
+#else
+	static __m128i mins8(__m128i a, __m128i b) { return sel(_mm_cmpgt_epi8(a, b), b, a); }
+	static __m128i maxs8(__m128i a, __m128i b) { return sel(_mm_cmpgt_epi8(a, b), a, b); }
+	static __m128i mins32(__m128i a, __m128i b) { return sel(_mm_cmpgt_epi32(a, b), b, a); }
+	static __m128i maxs32(__m128i a, __m128i b) { return sel(_mm_cmpgt_epi32(a, b), a, b); }
+	static __m128i minu16(__m128i a, __m128i b) { return sel(cgtu16(a, b), b, a); }
+	static __m128i maxu16(__m128i a, __m128i b) { return sel(cgtu16(a, b), a, b); }
+	static __m128i minu32(__m128i a, __m128i b) { return sel(cgtu32(a, b), b, a); }
+	static __m128i maxu32(__m128i a, __m128i b) { return sel(cgtu32(a, b), a, b); }
+#endif
+	static __m128i mins64(__m128i a, __m128i b) { return sel(cgts64(a, b), b, a); }
+	static __m128i maxs64(__m128i a, __m128i b) { return sel(cgts64(a, b), a, b); }
+	static __m128i minu64(__m128i a, __m128i b) { return sel(cgtu64(a, b), b, a); }
+	static __m128i maxu64(__m128i a, __m128i b) { return sel(cgtu64(a, b), a, b); }
+
+	// ordered float compares (false if any is NaN, like C++ operators)
+	static __m128 cmpeq_ps(__m128 a, __m128 b) { return _mm_cmpeq_ps(a, b); }
+	static __m128 cmpgt_ps(__m128 a, __m128 b) { return _mm_cmpgt_ps(a, b); }
+	static __m128d cmpeq_pd(__m128d a, __m128d b) { return _mm_cmpeq_pd(a, b); }
+	static __m128d cmpgt_pd(__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); }
+
+#ifdef __AVX__
+	static __m256 cmpeq_ps(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static __m256 cmpgt_ps(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static __m256d cmpeq_pd(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	static __m256d cmpgt_pd(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+#endif
+
+#ifdef __AVX2__
+	static __m256i sel(__m256i mask, __m256i a, __m256i b)
+	{
+		return _mm256_blendv_epi8(b, a, mask);
+	}
+
+	static __m256i cgts64(__m256i a, __m256i b) { return _mm256_cmpgt_epi64(a, b); }
+	static __m256i cgtu8(__m256i a, __m256i b) { const __m256i s = _mm256_set1_epi8(CHAR_MIN); return _mm256_cmpgt_epi8(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s)); }
+	static __m256i cgtu16(__m256i a, __m256i b) { const __m256i s = _mm256_set1_epi16(SHRT_MIN); return _mm256_cmpgt_epi16(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s)); }
+	static __m256i cgtu32(__m256i a, __m256i b) { const __m256i s = _mm256_set1_epi32(INT_MIN); return _mm256_cmpgt_epi32(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s)); }
+	static __m256i cgtu64(__m256i a, __m256i b) { const __m256i s = _mm256_set1_epi64x(LLONG_MIN); return _mm256_cmpgt_epi64(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s)); }
+	static __m256i mins8(__m256i a, __m256i b) { return _mm256_min_epi8(a, b); }
+	static __m256i maxs8(__m256i a, __m256i b) { return _mm256_max_epi8(a, b); }
+	static __m256i mins32(__m256i a, __m256i b) { return _mm256_min_epi32(a, b); }
+	static __m256i maxs32(__m256i a, __m256i b) { return _mm256_max_epi32(a, b); }
+	static __m256i minu16(__m256i a, __m256i b) { return _mm256_min_epu16(a, b); }
+	static __m256i maxu16(__m256i a, __m256i b) { return _mm256_max_epu16(a, b); }
+	static __m256i minu32(__m256i a, __m256i b) { return _mm256_min_epu32(a, b); }
+	static __m256i maxu32(__m256i a, __m256i b) { return _mm256_max_epu32(a, b); }
+	static __m256i mins64(__m256i a, __m256i b) { return sel(cgts64(a, b), b, a); }
+	static __m256i maxs64(__m256i a, __m256i b) { return sel(cgts64(a, b), a, b); }
+	static __m256i minu64(__m256i a, __m256i b) { return sel(cgtu64(a, b), b, a); }
+	static __m256i maxu64(__m256i a, __m256i b) { return sel(cgtu64(a, b), a, b); }
+
+	static __m256i mul8(__m256i a, __m256i b)
+	{
+		const __m256i even = _mm256_mullo_epi16(a, b);
+		const __m256i odd = _mm256_mullo_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+		return _mm256_or_si256(_mm256_and_si256(even, _mm256_set1_epi16(0xff)), _mm256_slli_epi16(odd, 8));
+	}
+
+	static __m256i mulhs8(__m256i a, __m256i b)
+	{
+		const __m256i even = _mm256_mullo_epi16(_mm256_srai_epi16(_mm256_slli_epi16(a, 8), 8), _mm256_srai_epi16(_mm256_slli_epi16(b, 8), 8));
+		const __m256i odd = _mm256_mullo_epi16(_mm256_srai_epi16(a, 8), _mm256_srai_epi16(b, 8));
+		return _mm256_or_si256(_mm256_srli_epi16(even, 8), _mm256_andnot_si256(_mm256_set1_epi16(0xff), odd));
+	}
+
+	static __m256i mulhu8(__m256i a, __m256i b)
+	{
+		const __m256i mask = _mm256_set1_epi16(0xff);
+		const __m256i even = _mm256_mullo_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+		const __m256i odd = _mm256_mullo_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+		return _mm256_or_si256(_mm256_srli_epi16(even, 8), _mm256_andnot_si256(mask, odd));
+	}
+
+	static __m256i mul32(__m256i a, __m256i b)
+	{
+		return _mm256_mullo_epi32(a, b);
+	}
+
+	static __m256i mulhu32(__m256i a, __m256i b)
+	{
+		const __m256i even = _mm256_mul_epu32(a, b);
+		const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+		return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+	}
+
+	static __m256i mulhs32(__m256i a, __m256i b)
+	{
+		const __m256i even = _mm256_mul_epi32(a, b);
+		const __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+		return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+	}
+
+	static __m256i mul64(__m256i a, __m256i b)
+	{
+		const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+		return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+	}
+#endif
+};
+
+// apply integer kernel to both operands (f256 for AVX2, f128 for each half otherwise)
+#ifdef __AVX2__
+#define SIMD_I(f256, f128) return ret(f256(vi(a), vi(b)))
+#else
+#define SIMD_I(f256, f128) return ret(f128(vi(a, 0), vi(b, 0)), f128(vi(a, 1), vi(b, 1)))
+#endif
+
+// apply float kernel (t = vs or vd)
+#ifdef __AVX__
+#define SIMD_F(t, f256, f128) return ret(f256(t(a), t(b)))
+#else
+#define SIMD_F(t, f256, f128) return ret(f128(t(a, 0), t(b, 0)), f128(t(a, 1), t(b, 1)))
+#endif
+
+template<typename T>
+struct A256Simd : A256Lanes<T>
+{
+};
+
+template<>
+struct A256Simd<f32> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_F(vs, _mm256_add_ps, _mm_add_ps); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_F(vs, _mm256_sub_ps, _mm_sub_ps); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_F(vs, _mm256_mul_ps, _mm_mul_ps); }
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_F(vs, cmpeq_ps, cmpeq_ps); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_F(vs, cmpgt_ps, cmpgt_ps); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_F(vs, _mm256_min_ps, _mm_min_ps); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_F(vs, _mm256_max_ps, _mm_max_ps); }
+};
+
+template<>
+struct A256Simd<f64> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_F(vd, _mm256_add_pd, _mm_add_pd); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_F(vd, _mm256_sub_pd, _mm_sub_pd); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_F(vd, _mm256_mul_pd, _mm_mul_pd); }
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_F(vd, cmpeq_pd, cmpeq_pd); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_F(vd, cmpgt_pd, cmpgt_pd); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_F(vd, _mm256_min_pd, _mm_min_pd); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_F(vd, _mm256_max_pd, _mm_max_pd); }
+};
+
+template<>
+struct A256Simd<s8> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_add_epi8, _mm_add_epi8); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_sub_epi8, _mm_sub_epi8); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_I(mul8, mul8); }
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(mulhs8, mulhs8); }
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpeq_epi8, _mm_cmpeq_epi8); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpgt_epi8, _mm_cmpgt_epi8); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(mins8, mins8); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxs8, maxs8); }
+};
+
+template<>
+struct A256Simd<u8> : A256Simd<s8>
+{
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(mulhu8, mulhu8); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(cgtu8, cgtu8); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_min_epu8, _mm_min_epu8); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_max_epu8, _mm_max_epu8); }
+};
+
+template<>
+struct A256Simd<s16> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_add_epi16, _mm_add_epi16); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_sub_epi16, _mm_sub_epi16); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_mullo_epi16, _mm_mullo_epi16); }
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_mulhi_epi16, _mm_mulhi_epi16); }
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpeq_epi16, _mm_cmpeq_epi16); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpgt_epi16, _mm_cmpgt_epi16); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_min_epi16, _mm_min_epi16); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_max_epi16, _mm_max_epi16); }
+};
+
+template<>
+struct A256Simd<u16> : A256Simd<s16>
+{
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_mulhi_epu16, _mm_mulhi_epu16); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(cgtu16, cgtu16); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(minu16, minu16); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxu16, maxu16); }
+};
+
+template<>
+struct A256Simd<s32> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_add_epi32, _mm_add_epi32); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_sub_epi32, _mm_sub_epi32); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_I(mul32, mul32); }
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(mulhs32, mulhs32); }
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpeq_epi32, _mm_cmpeq_epi32); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpgt_epi32, _mm_cmpgt_epi32); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(mins32, mins32); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxs32, maxs32); }
+};
+
+template<>
+struct A256Simd<u32> : A256Simd<s32>
+{
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { SIMD_I(mulhu32, mulhu32); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(cgtu32, cgtu32); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(minu32, minu32); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxu32, maxu32); }
+};
+
+template<>
+struct A256Simd<s64> : A256Vec
+{
+	static A256Reg add(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_add_epi64, _mm_add_epi64); }
+	static A256Reg sub(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_sub_epi64, _mm_sub_epi64); }
+	static A256Reg mul(A256Reg& a, A256Reg& b) { SIMD_I(mul64, mul64); }
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { return A256Lanes<s64>::mulh(a, b); } // no vector instruction
+	static A256Reg ceq(A256Reg& a, A256Reg& b) { SIMD_I(_mm256_cmpeq_epi64, ceqs64); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(cgts64, cgts64); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(mins64, mins64); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxs64, maxs64); }
+};
+
+template<>
+struct A256Simd<u64> : A256Simd<s64>
+{
+	static A256Reg mulh(A256Reg& a, A256Reg& b) { return A256Lanes<u64>::mulh(a, b); }
+	static A256Reg cgt(A256Reg& a, A256Reg& b) { SIMD_I(cgtu64, cgtu64); }
+	static A256Reg min(A256Reg& a, A256Reg& b) { SIMD_I(minu64, minu64); }
+	static A256Reg max(A256Reg& a, A256Reg& b) { SIMD_I(maxu64, maxu64); }
+};
+
+// shifts and rotates (sll*, slr*, sar*, rl*)
+
+/*
+1) A256Shift<T> takes unsigned T; each element is shifted by the element of the same size in the count register
+2) count >= element bits gives 0 (sll, slr) or the sign (sar); rl uses count modulo element bits
+3) AVX2: vpsllv/vpsrlv/vpsrav for dwords and qwords, words through dword shifts, bytes by bits of count (4, 2, 1 with blend)
+4) sar of bytes, words and qwords is slr of (x ^ sign) ^ sign
+5) without AVX2, elements are shifted together only if all counts are equal (immediate or broadcast), otherwise by A256Lanes
+6) dq/qq forms (A256Wide): each 128-bit half is shifted by its low qword (dq), or the whole register by qword 0 (qq, rlqq by byte 0)
+*/
+
+template<typename T>
+struct A256ShiftLanes
+{
+	static const u32 bits = 8 * sizeof(T);
+
+	static A256Reg sll(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			const T s = b.get<T>(i);
+			res.get<T>(i) = (s >= bits) ? 0 : (T)(a.get<T>(i) << s);
+		}
+		return res;
+	}
+
+	static A256Reg slr(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			const T s = b.get<T>(i);
+			res.get<T>(i) = (s >= bits) ? 0 : (T)(a.get<T>(i) >> s);
+		}
+		return res;
+	}
+
+	static A256Reg sar(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			const T s = b.get<T>(i);
+			const T v = a.get<T>(i);
+			const T sign = (v >> (bits - 1)) ? (T)~(T)0 : 0;
+			res.get<T>(i) = (s >= bits) ? sign : (T)(((T)(v ^ sign) >> s) ^ sign);
+		}
+		return res;
+	}
+
+	static A256Reg rl(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			const u32 r = b.get<T>(i) & (bits - 1);
+			const T v = a.get<T>(i);
+			res.get<T>(i) = r ? (T)((v << r) | (v >> (bits - r))) : v;
+		}
+		return res;
+	}
+};
+
+template<typename T>
+struct A256Shift : A256Vec
+{
+	static const u32 bits = 8 * sizeof(T);
+
+	// shift all elements by the same count c < bits (SSE2)
+
+	static __m128i sll1(__m128i v, u32 c)
+	{
+		const __m128i n = _mm_cvtsi32_si128(c);
+		switch (sizeof(T))
+		{
+		case 1: return _mm_and_si128(_mm_sll_epi16(v, n), _mm_set1_epi8((char)(0xff << c)));
+		case 2: return _mm_sll_epi16(v, n);
+		case 4: return _mm_sll_epi32(v, n);
+		default: return _mm_sll_epi64(v, n);
+		}
+	}
+
+	static __m128i srl1(__m128i v, u32 c)
+	{
+		const __m128i n = _mm_cvtsi32_si128(c);
+		switch (sizeof(T))
+		{
+		case 1: return _mm_and_si128(_mm_srl_epi16(v, n), _mm_set1_epi8((char)(0xff >> c)));
+		case 2: return _mm_srl_epi16(v, n);
+		case 4: return _mm_srl_epi32(v, n);
+		default: return _mm_srl_epi64(v, n);
+		}
+	}
+
+	static __m128i sign(__m128i v) // all bits of element set if negative
+	{
+		switch (sizeof(T))
+		{
+		case 1: return _mm_cmpgt_epi8(_mm_setzero_si128(), v);
+		case 2: return _mm_srai_epi16(v, 15);
+		case 4: return _mm_srai_epi32(v, 31);
+		default: return _mm_shuffle_epi32(_mm_srai_epi32(v, 31), 0xf5);
+		}
+	}
+
+	static bool uniform(A256Reg& b, u64& c) // all counts are equal
+	{
+		const T first = b.get<T>(0);
+		A256Reg all = A256Reg::set(first);
+		c = first;
+		return !memcmp(&all, &b, sizeof(A256Reg));
+	}
+
+#ifdef __AVX2__
+	// variable shifts (count of each element is less than 2^N, not necessarily less than bits)
+
+	static __m256i sign(__m256i v)
+	{
+		switch (sizeof(T))
+		{
+		case 1: return _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+		case 2: return _mm256_srai_epi16(v, 15);
+		case 4: return _mm256_srai_epi32(v, 31);
+		default: return _mm256_cmpgt_epi64(_mm256_setzero_si256(), v);
+		}
+	}
+
+	static __m256i small(__m256i c) // byte count < 8
+	{
+		return _mm256_cmpeq_epi8(_mm256_and_si256(c, _mm256_set1_epi8((char)0xf8)), _mm256_setzero_si256());
+	}
+
+	static __m256i sllv(__m256i v, __m256i c)
+	{
+		switch (sizeof(T))
+		{
+		case 1:
+		{
+			v = _mm256_blendv_epi8(v, _mm256_and_si256(_mm256_slli_epi16(v, 4), _mm256_set1_epi8((char)0xf0)), _mm256_slli_epi16(c, 5));
+			v = _mm256_blendv_epi8(v, _mm256_and_si256(_mm256_slli_epi16(v, 2), _mm256_set1_epi8((char)0xfc)), _mm256_slli_epi16(c, 6));
+			v = _mm256_blendv_epi8(v, _mm256_add_epi8(v, v), _mm256_slli_epi16(c, 7));
+			return _mm256_and_si256(v, small(c));
+		}
+		case 2:
+		{
+			const __m256i lo = _mm256_sllv_epi32(v, _mm256_and_si256(c, _mm256_set1_epi32(0xffff)));
+			const __m256i hi = _mm256_sllv_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xffff0000)), _mm256_srli_epi32(c, 16));
+			return _mm256_blend_epi16(lo, hi, 0xaa);
+		}
+		case 4: return _mm256_sllv_epi32(v, c);
+		default: return _mm256_sllv_epi64(v, c);
+		}
+	}
+
+	static __m256i srlv(__m256i v, __m256i c)
+	{
+		switch (sizeof(T))
+		{
+		case 1:
+		{
+			v = _mm256_blendv_epi8(v, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f)), _mm256_slli_epi16(c, 5));
+			v = _mm256_blendv_epi8(v, _mm256_and_si256(_mm256_srli_epi16(v, 2), _mm256_set1_epi8(0x3f)), _mm256_slli_epi16(c, 6));
+			v = _mm256_blendv_epi8(v, _mm256_and_si256(_mm256_srli_epi16(v, 1), _mm256_set1_epi8(0x7f)), _mm256_slli_epi16(c, 7));
+			return _mm256_and_si256(v, small(c));
+		}
+		case 2:
+		{
+			const __m256i lo = _mm256_srlv_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xffff)), _mm256_and_si256(c, _mm256_set1_epi32(0xffff)));
+			const __m256i hi = _mm256_srlv_epi32(v, _mm256_srli_epi32(c, 16));
+			return _mm256_blend_epi16(lo, hi, 0xaa);
+		}
+		case 4: return _mm256_srlv_epi32(v, c);
+		default: return _mm256_srlv_epi64(v, c);
+		}
+	}
+
+	static __m256i splat(u32 x)
+	{
+		switch (sizeof(T))
+		{
+		case 1: return _mm256_set1_epi8((char)x);
+		case 2: return _mm256_set1_epi16((short)x);
+		case 4: return _mm256_set1_epi32(x);
+		default: return _mm256_set1_epi64x(x);
+		}
+	}
+
+	static A256Reg sll(A256Reg& a, A256Reg& b)
+	{
+		return ret(sllv(vi(a), vi(b)));
+	}
+
+	static A256Reg slr(A256Reg& a, A256Reg& b)
+	{
+		return ret(srlv(vi(a), vi(b)));
+	}
+
+	static A256Reg sar(A256Reg& a, A256Reg& b)
+	{
+		if (sizeof(T) == 4)
+		{
+			return ret(_mm256_srav_epi32(vi(a), vi(b)));
+		}
+		const __m256i s = sign(vi(a));
+		return ret(_mm256_xor_si256(srlv(_mm256_xor_si256(vi(a), s), vi(b)), s));
+	}
+
+	static A256Reg rl(A256Reg& a, A256Reg& b) // srlv by bits gives 0 for r = 0
+	{
+		const __m256i r = _mm256_and_si256(vi(b), splat(bits - 1));
+		const __m256i n = splat(bits);
+		const __m256i l = sizeof(T) == 1 ? _mm256_sub_epi8(n, r) : sizeof(T) == 2 ? _mm256_sub_epi16(n, r) : sizeof(T) == 4 ? _mm256_sub_epi32(n, r) : _mm256_sub_epi64(n, r);
+		return ret(_mm256_or_si256(sllv(vi(a), r), srlv(vi(a), l)));
+	}
+#else
+	static A256Reg sll(A256Reg& a, A256Reg& b)
+	{
+		u64 c;
+		if (!uniform(b, c))
+		{
+			return A256ShiftLanes<T>::sll(a, b);
+		}
+		if (c >= bits)
+		{
+			return ret(_mm_setzero_si128(), _mm_setzero_si128());
+		}
+		return ret(sll1(vi(a, 0), (u32)c), sll1(vi(a, 1), (u32)c));
+	}
+
+	static A256Reg slr(A256Reg& a, A256Reg& b)
+	{
+		u64 c;
+		if (!uniform(b, c))
+		{
+			return A256ShiftLanes<T>::slr(a, b);
+		}
+		if (c >= bits)
+		{
+			return ret(_mm_setzero_si128(), _mm_setzero_si128());
+		}
+		return ret(srl1(vi(a, 0), (u32)c), srl1(vi(a, 1), (u32)c));
+	}
+
+	static A256Reg sar(A256Reg& a, A256Reg& b)
+	{
+		u64 c;
+		if (!uniform(b, c))
+		{
+			return A256ShiftLanes<T>::sar(a, b);
+		}
+		const __m128i s0 = sign(vi(a, 0));
+		const __m128i s1 = sign(vi(a, 1));
+		if (c >= bits)
+		{
+			return ret(s0, s1);
+		}
+		return ret(_mm_xor_si128(srl1(_mm_xor_si128(vi(a, 0), s0), (u32)c), s0), _mm_xor_si128(srl1(_mm_xor_si128(vi(a, 1), s1), (u32)c), s1));
+	}
+
+	static A256Reg rl(A256Reg& a, A256Reg& b)
+	{
+		u64 c;
+		if (!uniform(b, c))
+		{
+			return A256ShiftLanes<T>::rl(a, b);
+		}
+		const u32 r = (u32)c & (bits - 1);
+		if (r == 0)
+		{
+			return a;
+		}
+		return ret(_mm_or_si128(sll1(vi(a, 0), r), srl1(vi(a, 0), bits - r)), _mm_or_si128(sll1(vi(a, 1), r), srl1(vi(a, 1), bits - r)));
+	}
+#endif
+};
+
+struct A256WideLanes // reference implementation of dq/qq shifts
+{
+	static A256Reg slldq(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 j = 0; j < 4; j += 2)
+		{
+			const u64 q = b._uq[j] >> 6;
+			const u32 s = b._uq[j] & 63;
+			res._uq[j] = q ? 0 : a._uq[j] << s;
+			res._uq[j + 1] = q > 1 ? 0 : q ? a._uq[j] << s : (a._uq[j + 1] << s) | (s ? a._uq[j] >> (64 - s) : 0);
+		}
+		return res;
+	}
+
+	static A256Reg slrdq(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 j = 0; j < 4; j += 2)
+		{
+			const u64 q = b._uq[j] >> 6;
+			const u32 s = b._uq[j] & 63;
+			res._uq[j] = q > 1 ? 0 : q ? a._uq[j + 1] >> s : (a._uq[j] >> s) | (s ? a._uq[j + 1] << (64 - s) : 0);
+			res._uq[j + 1] = q ? 0 : a._uq[j + 1] >> s;
+		}
+		return res;
+	}
+
+	static A256Reg sardq(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 j = 0; j < 4; j += 2)
+		{
+			const u64 q = b._uq[j] >> 6;
+			const u32 s = b._uq[j] & 63;
+			const s64 sign = a._sq[j + 1] >> 63;
+			res._sq[j] = q > 1 ? sign : q ? a._sq[j + 1] >> s : (a._uq[j] >> s) | (s ? a._uq[j + 1] << (64 - s) : 0);
+			res._sq[j + 1] = q ? sign : a._sq[j + 1] >> s;
+		}
+		return res;
+	}
+
+	static A256Reg rldq(A256Reg& a, A256Reg& b)
+	{
+		A256Reg res;
+		for (u32 j = 0; j < 4; j += 2)
+		{
+			const u32 q = (b._uq[j] >> 6) & 1;
+			const u32 s = b._uq[j] & 63;
+			for (u32 i = 0; i < 2; i++)
+			{
+				res._uq[j + i] = (a._uq[j + (i ^ q)] << s) | (s ? a._uq[j + (i ^ q ^ 1)] >> (64 - s) : 0);
+			}
+		}
+		return res;
+	}
+
+	static A256Reg sllqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		const u32 s = b._uq[0] & 63;
+		A256Reg res;
+		for (u32 i = 0; i < 4; i++)
+		{
+			res._uq[i] = (q > i) ? 0 : (q == i) ? a._uq[0] << s : (a._uq[i - q] << s) | (s ? a._uq[i - q - 1] >> (64 - s) : 0);
+		}
+		return res;
+	}
+
+	static A256Reg slrqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		const u32 s = b._uq[0] & 63;
+		A256Reg res;
+		for (u32 i = 0; i < 4; i++)
+		{
+			res._uq[i] = (q + i > 3) ? 0 : (q + i == 3) ? a._uq[3] >> s : (a._uq[i + q] >> s) | (s ? a._uq[i + q + 1] << (64 - s) : 0);
+		}
+		return res;
+	}
+
+	static A256Reg sarqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		const u32 s = b._uq[0] & 63;
+		A256Reg res;
+		for (u32 i = 0; i < 4; i++)
+		{
+			res._sq[i] = (q + i > 3) ? a._sq[3] >> 63 : (q + i == 3) ? a._sq[3] >> s : (a._uq[i + q] >> s) | (s ? a._uq[i + q + 1] << (64 - s) : 0);
+		}
+		return res;
+	}
+
+	static A256Reg rlqq(A256Reg& a, A256Reg& b)
+	{
+		const u32 q = b._ub[0] >> 6;
+		const u32 s = b._ub[0] & 63;
+		A256Reg res;
+		for (u32 i = 0; i < 4; i++)
+		{
+			res._uq[i] = (a._uq[(i - q) & 3] << s) | (s ? a._uq[(i - q - 1) & 3] >> (64 - s) : 0);
+		}
+		return res;
+	}
+};
+
+struct A256Wide : A256Vec
+{
+	// dq: 128-bit halves as (y << s) | (y' >> (64 - s)), y is the half moved by whole qwords (SSE2)
+
+	static __m128i sll128(__m128i x, u64 n)
+	{
+		const __m128i y = n < 64 ? x : n < 128 ? _mm_slli_si128(x, 8) : _mm_setzero_si128();
+		const u32 s = n & 63;
+		return _mm_or_si128(_mm_sll_epi64(y, _mm_cvtsi32_si128(s)), _mm_srl_epi64(_mm_slli_si128(y, 8), _mm_cvtsi32_si128(64 - s)));
+	}
+
+	static __m128i srl128(__m128i x, u64 n)
+	{
+		const __m128i y = n < 64 ? x : n < 128 ? _mm_srli_si128(x, 8) : _mm_setzero_si128();
+		const u32 s = n & 63;
+		return _mm_or_si128(_mm_srl_epi64(y, _mm_cvtsi32_si128(s)), _mm_sll_epi64(_mm_srli_si128(y, 8), _mm_cvtsi32_si128(64 - s)));
+	}
+
+	static __m128i sign128(__m128i x) // sign of the high qword
+	{
+		return _mm_shuffle_epi32(_mm_srai_epi32(x, 31), 0xff);
+	}
+
+	static __m128i rl128(__m128i x, u64 n)
+	{
+		const __m128i y = (n & 64) ? _mm_shuffle_epi32(x, 0x4e) : x;
+		const u32 s = n & 63;
+		return _mm_or_si128(_mm_sll_epi64(y, _mm_cvtsi32_si128(s)), _mm_srl_epi64(_mm_shuffle_epi32(y, 0x4e), _mm_cvtsi32_si128(64 - s)));
+	}
+
+	static A256Reg slldq(A256Reg& a, A256Reg& b)
+	{
+		return ret(sll128(vi(a, 0), b._uq[0]), sll128(vi(a, 1), b._uq[2]));
+	}
+
+	static A256Reg slrdq(A256Reg& a, A256Reg& b)
+	{
+		return ret(srl128(vi(a, 0), b._uq[0]), srl128(vi(a, 1), b._uq[2]));
+	}
+
+	static A256Reg sardq(A256Reg& a, A256Reg& b)
+	{
+		const __m128i s0 = sign128(vi(a, 0));
+		const __m128i s1 = sign128(vi(a, 1));
+		return ret(_mm_xor_si128(srl128(_mm_xor_si128(vi(a, 0), s0), b._uq[0]), s0), _mm_xor_si128(srl128(_mm_xor_si128(vi(a, 1), s1), b._uq[2]), s1));
+	}
+
+	static A256Reg rldq(A256Reg& a, A256Reg& b)
+	{
+		return ret(rl128(vi(a, 0), b._uq[0]), rl128(vi(a, 1), b._uq[2]));
+	}
+
+#ifdef __AVX2__
+	// qq: qwords are moved across 128-bit halves with vpermq, then the same bit fix-up
+
+	static __m256i up(__m256i x, u64 q) // move qwords up by q (zero fill)
+	{
+		switch (q)
+		{
+		case 0: return x;
+		case 1: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), _mm256_setzero_si256(), 0x03);
+		case 2: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), _mm256_setzero_si256(), 0x0f);
+		case 3: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x00), _mm256_setzero_si256(), 0x3f);
+		default: return _mm256_setzero_si256();
+		}
+	}
+
+	static __m256i down(__m256i x, u64 q) // move qwords down by q (zero fill)
+	{
+		switch (q)
+		{
+		case 0: return x;
+		case 1: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0xf9), _mm256_setzero_si256(), 0xc0);
+		case 2: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0xfe), _mm256_setzero_si256(), 0xf0);
+		case 3: return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0xff), _mm256_setzero_si256(), 0xfc);
+		default: return _mm256_setzero_si256();
+		}
+	}
+
+	static __m256i rot(__m256i x, u32 q) // rotate qwords up by q
+	{
+		switch (q & 3)
+		{
+		case 0: return x;
+		case 1: return _mm256_permute4x64_epi64(x, 0x93);
+		case 2: return _mm256_permute4x64_epi64(x, 0x4e);
+		default: return _mm256_permute4x64_epi64(x, 0x39);
+		}
+	}
+
+	static __m256i fix(__m256i y, __m256i carry, u32 s, bool left) // (y << s) | (carry >> (64 - s)) or reverse
+	{
+		const __m128i n = _mm_cvtsi32_si128(s);
+		const __m128i m = _mm_cvtsi32_si128(64 - s);
+		return left ? _mm256_or_si256(_mm256_sll_epi64(y, n), _mm256_srl_epi64(carry, m)) : _mm256_or_si256(_mm256_srl_epi64(y, n), _mm256_sll_epi64(carry, m));
+	}
+
+	static A256Reg sllqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		return ret(fix(up(vi(a), q), up(vi(a), q + 1), b._uq[0] & 63, true));
+	}
+
+	static A256Reg slrqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		return ret(fix(down(vi(a), q), down(vi(a), q + 1), b._uq[0] & 63, false));
+	}
+
+	static A256Reg sarqq(A256Reg& a, A256Reg& b)
+	{
+		const u64 q = b._uq[0] >> 6;
+		const __m256i s = _mm256_cmpgt_epi64(_mm256_setzero_si256(), _mm256_permute4x64_epi64(vi(a), 0xff));
+		const __m256i x = _mm256_xor_si256(vi(a), s);
+		return ret(_mm256_xor_si256(fix(down(x, q), down(x, q + 1), b._uq[0] & 63, false), s));
+	}
+
+	static A256Reg rlqq(A256Reg& a, A256Reg& b)
+	{
+		const u32 q = b._ub[0] >> 6;
+		return ret(fix(rot(vi(a), q), rot(vi(a), q + 1), b._ub[0] & 63, true));
+	}
+#else
+	static A256Reg sllqq(A256Reg& a, A256Reg& b) { return A256WideLanes::sllqq(a, b); }
+	static A256Reg slrqq(A256Reg& a, A256Reg& b) { return A256WideLanes::slrqq(a, b); }
+	static A256Reg sarqq(A256Reg& a, A256Reg& b) { return A256WideLanes::sarqq(a, b); }
+	static A256Reg rlqq(A256Reg& a, A256Reg& b) { return A256WideLanes::rlqq(a, b); }
+#endif
+};
+
+// byte shuffles (shufb, shufbx)
+
+/*
+1) mask byte bit 7 set: result byte is zero
+2) mask byte bits 0 .. 4: byte index in the source register (across 128-bit halves)
+3) mask byte bits 5 .. 6: source register of shufbx (ignored by shufb)
+4) vector kernels (pshufb per 128-bit half, selection by mask bits with pblendvb) need SSE4.1 (enabled with AVX)
+*/
+
+struct A256Shuffle : A256Vec
+{
+	static A256Reg lanes(A256Reg& mask, A256Reg* data) // reference implementation (4 sources)
+	{
+		A256Reg res;
+		for (u32 i = 0; i < 32; i++)
+		{
+			res._ub[i] = (mask._ub[i] & 0x80) ? 0 : data[(mask._ub[i] >> 5) & 3]._ub[mask._ub[i] % 32];
+		}
+		return res;
+	}
+
+	static A256Reg lanes(A256Reg& mask, A256Reg& data)
+	{
+		A256Reg sources[4] = { data, data, data, data };
+		return lanes(mask, sources);
+	}
+
+#ifdef __AVX2__
+	static __m256i bit(__m256i mask, u32 n) // move mask bit n to bit 7 for blendv (shifted bits don't cross bytes at bit 7)
+	{
+		switch (n)
+		{
+		case 4: return _mm256_slli_epi16(mask, 3);
+		case 5: return _mm256_slli_epi16(mask, 2);
+		default: return _mm256_slli_epi16(mask, 1);
+		}
+	}
+
+	static __m256i table(__m256i mask, __m256i data) // 32-byte lookup: both halves of data in each 128-bit lane
+	{
+		const __m256i lo = _mm256_shuffle_epi8(_mm256_permute2x128_si256(data, data, 0x00), mask);
+		const __m256i hi = _mm256_shuffle_epi8(_mm256_permute2x128_si256(data, data, 0x11), mask);
+		return _mm256_blendv_epi8(lo, hi, bit(mask, 4));
+	}
+
+	static A256Reg shufb(A256Reg& mask, A256Reg& data)
+	{
+		return ret(table(vi(mask), vi(data)));
+	}
+
+	static A256Reg shufbx(A256Reg& mask, A256Reg* data)
+	{
+		const __m256i m = vi(mask);
+		const __m256i sel5 = bit(m, 5);
+		const __m256i t01 = _mm256_blendv_epi8(table(m, vi(data[0])), table(m, vi(data[1])), sel5);
+		const __m256i t23 = _mm256_blendv_epi8(table(m, vi(data[2])), table(m, vi(data[3])), sel5);
+		return ret(_mm256_blendv_epi8(t01, t23, bit(m, 6)));
+	}
+#elif defined(__AVX__)
+	static __m128i bit(__m128i mask, u32 n)
+	{
+		switch (n)
+		{
+		case 4: return _mm_slli_epi16(mask, 3);
+		case 5: return _mm_slli_epi16(mask, 2);
+		default: return _mm_slli_epi16(mask, 1);
+		}
+	}
+
+	static __m128i table(__m128i mask, A256Reg& data)
+	{
+		return _mm_blendv_epi8(_mm_shuffle_epi8(vi(data, 0), mask), _mm_shuffle_epi8(vi(data, 1), mask), bit(mask, 4));
+	}
+
+	static __m128i table4(__m128i mask, A256Reg* data)
+	{
+		const __m128i sel5 = bit(mask, 5);
+		const __m128i t01 = _mm_blendv_epi8(table(mask, data[0]), table(mask, data[1]), sel5);
+		const __m128i t23 = _mm_blendv_epi8(table(mask, data[2]), table(mask, data[3]), sel5);
+		return _mm_blendv_epi8(t01, t23, bit(mask, 6));
+	}
+
+	static A256Reg shufb(A256Reg& mask, A256Reg& data)
+	{
+		return ret(table(vi(mask, 0), data), table(vi(mask, 1), data));
+	}
+
+	static A256Reg shufbx(A256Reg& mask, A256Reg* data)
+	{
+		return ret(table4(vi(mask, 0), data), table4(vi(mask, 1), data));
+	}
+#else
+	static A256Reg shufb(A256Reg& mask, A256Reg& data)
+	{
+		return lanes(mask, data);
+	}
+
+	static A256Reg shufbx(A256Reg& mask, A256Reg* data)
+	{
+		return lanes(mask, data);
+	}
+#endif
+};
+
+// gather and scatter (gather*, scatter*)
+
+/*
+1) lane i address is base + index[i] * sizeof(T), indices are signed lanes of the same size
+2) every address is mapped like A256Machine::guest(): mem_base | (address & mem_mask)
+3) only lanes selected by mask (dword bits, any bit of a qword lane) are accessed, other gathered lanes keep old value
+4) scatter stores lanes in ascending order, the highest lane wins if addresses collide
+5) AVX2 gather maps 64-bit addresses in vector registers and loads with vpgatherqd/vpgatherqq (no scatter before AVX-512)
+*/
+
+template<typename T>
+struct A256GatherLanes // T is u32 or u64
+{
+	static bool active(u32 mask, u32 i)
+	{
+		return sizeof(T) == 4 ? (mask >> i) & 1 : (mask >> (i * 2)) & 3;
+	}
+
+	static T* addr(u64 base, A256Reg& index, u32 i, u64 mem_base, u64 mem_mask)
+	{
+		const s64 n = sizeof(T) == 4 ? (s64)index._sd[i] : index._sq[i];
+		return (T*)(mem_base | ((base + n * sizeof(T)) & mem_mask));
+	}
+
+	static A256Reg gather(A256Reg& old, u64 base, A256Reg& index, u32 mask, u64 mem_base, u64 mem_mask)
+	{
+		A256Reg res = old;
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			if (active(mask, i))
+			{
+				res.get<T>(i) = *addr(base, index, i, mem_base, mem_mask);
+			}
+		}
+		return res;
+	}
+
+	static void scatter(A256Reg& data, u64 base, A256Reg& index, u32 mask, u64 mem_base, u64 mem_mask)
+	{
+		for (u32 i = 0; i < 32 / sizeof(T); i++)
+		{
+			if (active(mask, i))
+			{
+				*addr(base, index, i, mem_base, mem_mask) = data.get<T>(i);
+			}
+		}
+	}
+};
+
+template<typename T>
+struct A256Gather : A256GatherLanes<T>
+{
+};
+
+#ifdef __AVX2__
+struct A256GatherVec : A256Vec
+{
+	static __m256i map(__m256i offset, u64 base, u64 mem_base, u64 mem_mask) // mapped addresses of 4 lanes
+	{
+		const __m256i a = _mm256_add_epi64(_mm256_set1_epi64x(base), offset);
+		return _mm256_or_si256(_mm256_and_si256(a, _mm256_set1_epi64x(mem_mask)), _mm256_set1_epi64x(mem_base));
+	}
+
+	static __m256i select(u32 mask) // all bits of dword i set if mask bit i is set
+	{
+		const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+	}
+};
+
+template<>
+struct A256Gather<u32> : A256GatherLanes<u32>, A256GatherVec
+{
+	static A256Reg gather(A256Reg& old, u64 base, A256Reg& index, u32 mask, u64 mem_base, u64 mem_mask)
+	{
+		const __m256i m = select(mask);
+		const __m256i lo = map(_mm256_slli_epi64(_mm256_cvtepi32_epi64(vi(index, 0)), 2), base, mem_base, mem_mask);
+		const __m256i hi = map(_mm256_slli_epi64(_mm256_cvtepi32_epi64(vi(index, 1)), 2), base, mem_base, mem_mask);
+		return ret(_mm256_mask_i64gather_epi32(vi(old, 0), nullptr, lo, _mm256_castsi256_si128(m), 1),
+			_mm256_mask_i64gather_epi32(vi(old, 1), nullptr, hi, _mm256_extracti128_si256(m, 1), 1));
+	}
+};
+
+template<>
+struct A256Gather<u64> : A256GatherLanes<u64>, A256GatherVec
+{
+	static A256Reg gather(A256Reg& old, u64 base, A256Reg& index, u32 mask, u64 mem_base, u64 mem_mask)
+	{
+		const __m256i m = select(mask);
+		const __m256i a = map(_mm256_slli_epi64(vi(index), 3), base, mem_base, mem_mask);
+		return ret(_mm256_mask_i64gather_epi64(vi(old), nullptr, a, _mm256_or_si256(m, _mm256_shuffle_epi32(m, 0xb1)), 1));
+	}
+};
+#endif
+
+// block memory (blkcpy, blkmov, blkset, blkcmp)
+
+/*
+1) small blocks use host memcpy/memmove/memcmp, large copies and fills use non-temporal stores to bypass the cache
+2) blkset repeats 32-byte pattern from the block start, so the pattern is rotated when the destination is aligned
+3) compare returns index of the first different byte (size if equal) and the sign of that difference
+*/
+
+struct A256Bulk
+{
+	static const u64 stream_min = 0x400000; // non-temporal stores from this size (larger than usual L2, part of L3)
+
+#ifdef __AVX__
+	typedef __m256i V;
+	static V load(const u8* p) { return _mm256_loadu_si256((const V*)p); }
+	static void stream(u8* p, V v) { _mm256_stream_si256((V*)p, v); }
+#else
+	typedef __m128i V;
+	static V load(const u8* p) { return _mm_loadu_si128((const V*)p); }
+	static void stream(u8* p, V v) { _mm_stream_si128((V*)p, v); }
+#endif
+
+	static u64 head(u8* dst, u64 size) // bytes before aligned destination
+	{
+		return std::min<u64>((0 - (u64)dst) % sizeof(V), size);
+	}
+
+	static void copy(u8* dst, const u8* src, u64 size)
+	{
+		if (size < stream_min)
+		{
+			memcpy(dst, src, size);
+			return;
+		}
+		const u64 h = head(dst, size);
+		memcpy(dst, src, h);
+		u64 i = h;
+		for (; i + 4 * sizeof(V) <= size; i += 4 * sizeof(V))
+		{
+			const V v0 = load(src + i);
+			const V v1 = load(src + i + sizeof(V));
+			const V v2 = load(src + i + 2 * sizeof(V));
+			const V v3 = load(src + i + 3 * sizeof(V));
+			stream(dst + i, v0);
+			stream(dst + i + sizeof(V), v1);
+			stream(dst + i + 2 * sizeof(V), v2);
+			stream(dst + i + 3 * sizeof(V), v3);
+		}
+		_mm_sfence();
+		memcpy(dst + i, src + i, size - i);
+	}
+
+	static void move(u8* dst, const u8* src, u64 size)
+	{
+		if (dst + size <= src || src + size <= dst)
+		{
+			copy(dst, src, size);
+		}
+		else
+		{
+			memmove(dst, src, size);
+		}
+	}
+
+	static void fill(u8* dst, const A256Reg& pattern, u64 size)
+	{
+		u8 buf[64]; // pattern twice, any 32-byte rotation is a contiguous load
+		memcpy(buf, &pattern, 32);
+		memcpy(buf + 32, &pattern, 32);
+		const u64 h = size < stream_min ? 0 : head(dst, size);
+		for (u64 i = 0; i < h; i++)
+		{
+			dst[i] = buf[i % 32];
+		}
+		u64 i = h;
+		if (size >= stream_min)
+		{
+			const V v = load(buf + i % 32); // same phase for every aligned store (sizeof(V) divides 32)
+#ifdef __AVX__
+			const V w = v;
+#else
+			const V w = load(buf + (i + 16) % 32);
+#endif
+			for (; i + 2 * sizeof(V) <= size; i += 2 * sizeof(V))
+			{
+				stream(dst + i, v);
+				stream(dst + i + sizeof(V), w);
+			}
+			_mm_sfence();
+		}
+		for (; i + 32 <= size; i += 32)
+		{
+			memcpy(dst + i, buf + i % 32, 32);
+		}
+		memcpy(dst + i, buf + i % 32, size - i);
+	}
+
+	static u64 compare(const u8* a, const u8* b, u64 size, s64& sign)
+	{
+		u64 i = 0;
+		for (; i + 16 <= size; i += 16)
+		{
+			const u32 ne = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)))) & 0xffff;
+			if (ne)
+			{
+				u32 n = 0;
+				while (!(ne & (1 << n)))
+				{
+					n++;
+				}
+				i += n;
+				sign = a[i] < b[i] ? -1 : 1;
+				return i;
+			}
+		}
+		for (; i < size; i++)
+		{
+			if (a[i] != b[i])
+			{
+				sign = a[i] < b[i] ? -1 : 1;
+				return i;
+			}
+		}
+		sign = 0;
+		return size;
+	}
+};
+
+// bsc1 conversions (zxbw .. sxdq, getfss .. getsq)
+
+/*
+1) Tin value is read from the start of each slot of max(sizeof(Tin), sizeof(Tout)) bytes
+2) Tout value is written to the start of the same slot with saturation, the rest of the slot is zeroed
+3) vector kernels need SSE4.1 (enabled with AVX), integer kernels use AVX2 if enabled
+4) integer pairs: extension within the slot, min/max with Tout bounds, masking
+5) float pairs: f32 from/to 8 .. 32-bit integers, f32 from/to f64; other pairs (64-bit integers, f64 from/to integers) are not vectorized
+*/
+
+template<typename Tin, typename Tout>
+struct A256ConvertLanes
+{
+	static const u32 slot = sizeof(Tin) > sizeof(Tout) ? sizeof(Tin) : sizeof(Tout);
+
+	static A256Reg convert(A256Reg& a)
+	{
+		A256Reg res;
+		res.fill<u64>(0);
+		for (u32 i = 0; i < 32 / slot; i++)
+		{
+			A256Reg::saturate<Tout, Tin>(*(Tout*)(res._ub + i * slot), *(Tin*)(a._ub + i * slot));
+		}
+		return res;
+	}
+};
+
+enum A256ConvertType : u32 // kernel selected by A256ConvertKind
+{
+	cvtLanes, // reference implementation
+	cvtCopy, // same type
+	cvtInteger,
+	cvtFloat,
+};
+
+template<typename Tin, typename Tout>
+struct A256ConvertKind
+{
+	static const bool in_float = !std::numeric_limits<Tin>::is_exact;
+	static const bool out_float = !std::numeric_limits<Tout>::is_exact;
+	static const bool same = sizeof(Tin) == sizeof(Tout) && in_float == out_float && std::numeric_limits<Tin>::is_signed == std::numeric_limits<Tout>::is_signed;
+	static const bool single = (in_float && sizeof(Tin) == 4 && (out_float || sizeof(Tout) <= 4)) || (out_float && sizeof(Tout) == 4 && (in_float || sizeof(Tin) <= 4));
+
+#ifdef __AVX__
+	static const u32 value = same ? cvtCopy : !in_float && !out_float ? cvtInteger : single ? cvtFloat : cvtLanes;
+#else
+	static const u32 value = same ? cvtCopy : cvtLanes;
+#endif
+};
+
+#ifdef __AVX__
+template<u32 S>
+struct A256Slot; // integer kernels for slots of S bytes (overloaded for AVX2)
+
+template<>
+struct A256Slot<1>
+{
+	template<u32 B> static __m128i sext(__m128i v) { return v; }
+	template<u32 B> static __m128i zext(__m128i v) { return v; }
+	static __m128i set(__m128i, s64 x) { return _mm_set1_epi8((char)x); }
+	static __m128i smax(__m128i a, __m128i b) { return _mm_max_epi8(a, b); }
+	static __m128i smin(__m128i a, __m128i b) { return _mm_min_epi8(a, b); }
+	static __m128i umin(__m128i a, __m128i b) { return _mm_min_epu8(a, b); }
+#ifdef __AVX2__
+	template<u32 B> static __m256i sext(__m256i v) { return v; }
+	template<u32 B> static __m256i zext(__m256i v) { return v; }
+	static __m256i set(__m256i, s64 x) { return _mm256_set1_epi8((char)x); }
+	static __m256i smax(__m256i a, __m256i b) { return _mm256_max_epi8(a, b); }
+	static __m256i smin(__m256i a, __m256i b) { return _mm256_min_epi8(a, b); }
+	static __m256i umin(__m256i a, __m256i b) { return _mm256_min_epu8(a, b); }
+#endif
+};
+
+template<>
+struct A256Slot<2>
+{
+	template<u32 B> static __m128i sext(__m128i v) { return _mm_srai_epi16(_mm_slli_epi16(v, 16 - B * 8), 16 - B * 8); }
+	template<u32 B> static __m128i zext(__m128i v) { return _mm_and_si128(v, _mm_set1_epi16((short)(0xffffu >> (16 - B * 8)))); }
+	static __m128i set(__m128i, s64 x) { return _mm_set1_epi16((short)x); }
+	static __m128i smax(__m128i a, __m128i b) { return _mm_max_epi16(a, b); }
+	static __m128i smin(__m128i a, __m128i b) { return _mm_min_epi16(a, b); }
+	static __m128i umin(__m128i a, __m128i b) { return _mm_min_epu16(a, b); }
+#ifdef __AVX2__
+	template<u32 B> static __m256i sext(__m256i v) { return _mm256_srai_epi16(_mm256_slli_epi16(v, 16 - B * 8), 16 - B * 8); }
+	template<u32 B> static __m256i zext(__m256i v) { return _mm256_and_si256(v, _mm256_set1_epi16((short)(0xffffu >> (16 - B * 8)))); }
+	static __m256i set(__m256i, s64 x) { return _mm256_set1_epi16((short)x); }
+	static __m256i smax(__m256i a, __m256i b) { return _mm256_max_epi16(a, b); }
+	static __m256i smin(__m256i a, __m256i b) { return _mm256_min_epi16(a, b); }
+	static __m256i umin(__m256i a, __m256i b) { return _mm256_min_epu16(a, b); }
+#endif
+};
+
+template<>
+struct A256Slot<4>
+{
+	template<u32 B> static __m128i sext(__m128i v) { return _mm_srai_epi32(_mm_slli_epi32(v, 32 - B * 8), 32 - B * 8); }
+	template<u32 B> static __m128i zext(__m128i v) { return _mm_and_si128(v, _mm_set1_epi32((int)(0xffffffffu >> (32 - B * 8)))); }
+	static __m128i set(__m128i, s64 x) { return _mm_set1_epi32((int)x); }
+	static __m128i smax(__m128i a, __m128i b) { return _mm_max_epi32(a, b); }
+	static __m128i smin(__m128i a, __m128i b) { return _mm_min_epi32(a, b); }
+	static __m128i umin(__m128i a, __m128i b) { return _mm_min_epu32(a, b); }
+#ifdef __AVX2__
+	template<u32 B> static __m256i sext(__m256i v) { return _mm256_srai_epi32(_mm256_slli_epi32(v, 32 - B * 8), 32 - B * 8); }
+	template<u32 B> static __m256i zext(__m256i v) { return _mm256_and_si256(v, _mm256_set1_epi32((int)(0xffffffffu >> (32 - B * 8)))); }
+	static __m256i set(__m256i, s64 x) { return _mm256_set1_epi32((int)x); }
+	static __m256i smax(__m256i a, __m256i b) { return _mm256_max_epi32(a, b); }
+	static __m256i smin(__m256i a, __m256i b) { return _mm256_min_epi32(a, b); }
+	static __m256i umin(__m256i a, __m256i b) { return _mm256_min_epu32(a, b); }
+#endif
+};
+
+template<>
+struct A256Slot<8> // no 64-bit arithmetic shift and min/max: compare and blend
+{
+	template<u32 B> static __m128i sext(__m128i v)
+	{
+		const __m128i top = _mm_slli_epi64(v, 64 - B * 8);
+		const __m128i sign = _mm_shuffle_epi32(_mm_srai_epi32(top, 31), 0xf5);
+		return _mm_or_si128(_mm_srli_epi64(top, 64 - B * 8), _mm_slli_epi64(sign, B * 8));
+	}
+	template<u32 B> static __m128i zext(__m128i v) { return _mm_and_si128(v, _mm_set1_epi64x((s64)(~0ull >> (64 - B * 8)))); }
+	static __m128i set(__m128i, s64 x) { return _mm_set1_epi64x(x); }
+	static __m128i smax(__m128i a, __m128i b) { return _mm_blendv_epi8(b, a, _mm_cmpgt_epi64(a, b)); }
+	static __m128i smin(__m128i a, __m128i b) { return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(a, b)); }
+	static __m128i umin(__m128i a, __m128i b)
+	{
+		const __m128i bias = _mm_set1_epi64x(LLONG_MIN);
+		return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)));
+	}
+#ifdef __AVX2__
+	template<u32 B> static __m256i sext(__m256i v)
+	{
+		const __m256i top = _mm256_slli_epi64(v, 64 - B * 8);
+		const __m256i sign = _mm256_shuffle_epi32(_mm256_srai_epi32(top, 31), 0xf5);
+		return _mm256_or_si256(_mm256_srli_epi64(top, 64 - B * 8), _mm256_slli_epi64(sign, B * 8));
+	}
+	template<u32 B> static __m256i zext(__m256i v) { return _mm256_and_si256(v, _mm256_set1_epi64x((s64)(~0ull >> (64 - B * 8)))); }
+	static __m256i set(__m256i, s64 x) { return _mm256_set1_epi64x(x); }
+	static __m256i smax(__m256i a, __m256i b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+	static __m256i smin(__m256i a, __m256i b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+	static __m256i umin(__m256i a, __m256i b)
+	{
+		const __m256i bias = _mm256_set1_epi64x(LLONG_MIN);
+		return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(_mm256_xor_si256(a, bias), _mm256_xor_si256(b, bias)));
+	}
+#endif
+};
+
+// apply conversion kernel to the operand
+#ifdef __AVX2__
+#define SIMD_C(f) return ret(f(vi(a)))
+#else
+#define SIMD_C(f) return ret(f(vi(a, 0)), f(vi(a, 1)))
+#endif
+
+template<typename Tin, typename Tout>
+struct A256ConvertInt : A256Vec
+{
+	typedef A256Slot<A256ConvertLanes<Tin, Tout>::slot> slot;
+	static const u32 S = A256ConvertLanes<Tin, Tout>::slot;
+
+	template<typename V>
+	static V run(V v)
+	{
+		const bool in_signed = std::numeric_limits<Tin>::is_signed;
+		const bool out_signed = std::numeric_limits<Tout>::is_signed;
+		if (sizeof(Tin) < S) // widening: extend Tin to the whole slot
+		{
+			v = in_signed ? slot::template sext<sizeof(Tin)>(v) : slot::template zext<sizeof(Tin)>(v);
+		}
+		if (in_signed)
+		{
+			if (!out_signed)
+			{
+				v = slot::smax(v, slot::set(v, 0));
+			}
+			else if (sizeof(Tout) < S)
+			{
+				v = slot::smax(v, slot::set(v, (s64)std::numeric_limits<Tout>::min()));
+			}
+			if (sizeof(Tout) < S)
+			{
+				v = slot::smin(v, slot::set(v, (s64)std::numeric_limits<Tout>::max()));
+			}
+		}
+		else if (sizeof(Tin) == S && (sizeof(Tout) < S || out_signed))
+		{
+			v = slot::umin(v, slot::set(v, (s64)std::numeric_limits<Tout>::max()));
+		}
+		if (sizeof(Tout) < S) // narrowing: zero the rest of the slot
+		{
+			v = slot::template zext<sizeof(Tout)>(v);
+		}
+		return v;
+	}
+
+	static A256Reg convert(A256Reg& a) { SIMD_C(run); }
+};
+
+template<typename Tin, typename Tout>
+struct A256ConvertFloat : A256Vec
+{
+	static const u32 in_size = sizeof(Tin) < 4 ? sizeof(Tin) : 4; // integer size (f64 is never converted to integer here)
+	static const u32 out_size = sizeof(Tout) < 4 ? sizeof(Tout) : 4;
+
+	static __m128i run(__m128 x) // f32 to integer (truncation)
+	{
+		x = _mm_and_ps(x, _mm_cmpord_ps(x, x)); // NaN is 0
+		if (sizeof(Tout) == 4 && std::numeric_limits<Tout>::is_signed) // overflow gives 0x80000000, fix positive
+		{
+			const __m128 over = _mm_cmpge_ps(x, _mm_set1_ps(2147483648.0f));
+			return _mm_xor_si128(_mm_cvttps_epi32(x), _mm_castps_si128(over));
+		}
+		if (sizeof(Tout) == 4) // unsigned: convert x - 2^31 if x >= 2^31
+		{
+			x = _mm_max_ps(x, _mm_setzero_ps());
+			const __m128 big = _mm_cmpge_ps(x, _mm_set1_ps(2147483648.0f));
+			const __m128 over = _mm_cmpge_ps(x, _mm_set1_ps(4294967296.0f));
+			const __m128i res = _mm_cvttps_epi32(_mm_sub_ps(x, _mm_and_ps(big, _mm_set1_ps(2147483648.0f))));
+			return _mm_or_si128(_mm_xor_si128(res, _mm_slli_epi32(_mm_castps_si128(big), 31)), _mm_castps_si128(over));
+		}
+		x = _mm_max_ps(x, _mm_set1_ps((f32)std::numeric_limits<Tout>::min()));
+		x = _mm_min_ps(x, _mm_set1_ps((f32)std::numeric_limits<Tout>::max()));
+		return A256Slot<4>::zext<out_size>(_mm_cvttps_epi32(x));
+	}
+
+	static __m128 run(__m128i v) // integer to f32
+	{
+		if (sizeof(Tin) < 4)
+		{
+			v = std::numeric_limits<Tin>::is_signed ? A256Slot<4>::sext<in_size>(v) : A256Slot<4>::zext<in_size>(v);
+		}
+		else if (!std::numeric_limits<Tin>::is_signed) // unsigned dword: both halves are exact, sum is rounded once
+		{
+			const __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v, 16)), _mm_set1_ps(65536.0f));
+			return _mm_add_ps(hi, _mm_cvtepi32_ps(_mm_and_si128(v, _mm_set1_epi32(0xffff))));
+		}
+		return _mm_cvtepi32_ps(v);
+	}
+
+	static A256Reg convert(A256Reg& a)
+	{
+		if (sizeof(Tin) == 4 && sizeof(Tout) == 8) // f32 to f64
+		{
+			return ret(_mm_cvtps_pd(_mm_shuffle_ps(vs(a, 0), vs(a, 0), 0x08)), _mm_cvtps_pd(_mm_shuffle_ps(vs(a, 1), vs(a, 1), 0x08)));
+		}
+		if (sizeof(Tin) == 8) // f64 to f32
+		{
+			return ret(_mm_unpacklo_ps(_mm_cvtpd_ps(vd(a, 0)), _mm_setzero_ps()), _mm_unpacklo_ps(_mm_cvtpd_ps(vd(a, 1)), _mm_setzero_ps()));
+		}
+		if (!std::numeric_limits<Tin>::is_exact)
+		{
+			return ret(run(vs(a, 0)), run(vs(a, 1)));
+		}
+		return ret(run(vi(a, 0)), run(vi(a, 1)));
+	}
+};
+#endif
+
+template<typename Tin, typename Tout, u32 kind>
+struct A256ConvertKernel : A256ConvertLanes<Tin, Tout>
+{
+};
+
+template<typename Tin, typename Tout>
+struct A256ConvertKernel<Tin, Tout, cvtCopy>
+{
+	static A256Reg convert(A256Reg& a) { return a; }
+};
+
+#ifdef __AVX__
+template<typename Tin, typename Tout>
+struct A256ConvertKernel<Tin, Tout, cvtInteger> : A256ConvertInt<Tin, Tout>
+{
+};
+
+template<typename Tin, typename Tout>
+struct A256ConvertKernel<Tin, Tout, cvtFloat> : A256ConvertFloat<Tin, Tout>
+{
+};
+#endif
+
+template<typename Tin, typename Tout>
+struct A256Convert : A256ConvertKernel<Tin, Tout, A256ConvertKind<Tin, Tout>::value>
+{
+};
+
+#undef SIMD_F
+#undef SIMD_I
+#undef SIMD_C
@@ -0,0 +1,663 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include "../A256Core/A256Batch.h"
+#include "../A256Core/A256Jit.h"
+#include "../A256Core/A256Scheduler.h"
+#include "../A256Core/A256Memory.h"
+#include "A256Samples.h"
+
+// micro-benchmarks (A256Test -bench)
+
+template<typename F>
+double bench_rate(u64 count, F func) // calls per second
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	func(count);
+	const std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - start;
+	return count / time.count();
+}
+
+template<typename T, A256Reg (*func)(A256Reg&, A256Reg&)>
+A256Reg bench_kernel(u64 count)
+{
+	A256Reg value = A256Reg::set<T>((T)1);
+	A256Reg step = A256Reg::set<T>((T)3);
+	for (u64 i = 0; i < count; i++)
+	{
+		value = func(value, step);
+	}
+	return value;
+}
+
+template<typename T, A256Reg (*before)(A256Reg&, A256Reg&), A256Reg (*after)(A256Reg&, A256Reg&)>
+void bench_kernels(const char* name) // compare two implementations of element-wise operation
+{
+	const u64 count = 1 << 22;
+	A256Reg res[2];
+	const double rate0 = bench_rate(count, [&](u64 n){ res[0] = bench_kernel<T, before>(n); });
+	const double rate1 = bench_rate(count, [&](u64 n){ res[1] = bench_kernel<T, after>(n); });
+	printf("%-8s %8.0f -> %8.0f Mlanes/s (x%.1f)%s\n", name, rate0 * (32 / sizeof(T)) / 1e6, rate1 * (32 / sizeof(T)) / 1e6,
+		rate1 / rate0, memcmp(&res[0], &res[1], sizeof(A256Reg)) ? " (results differ)" : "");
+}
+
+template<u32 blend>
+A256Reg bench_save(u64 count, u32 mask, u32 step) // write-back, mask changes by step
+{
+	A256Reg dst = A256Reg::set<u32>(0);
+	A256Reg src = A256Reg::set<u32>(1);
+	for (u64 i = 0; i < count; i++)
+	{
+		const u32 m = (mask + step * (u32)i) & 0xff;
+		if (blend)
+		{
+			dst.save(src, m);
+		}
+		else
+		{
+			for (u32 j = 0; j < 8; j++) if (m & (1 << j)) dst._ud[j] = src._ud[j]; // old RSAVE1
+		}
+		src._ud[i % 8]++;
+	}
+	return dst;
+}
+
+void bench_saves(const char* name, u32 mask, u32 step)
+{
+	const u64 count = 1 << 24;
+	A256Reg res[2];
+	const double rate0 = bench_rate(count, [&](u64 n){ res[0] = bench_save<0>(n, mask, step); });
+	const double rate1 = bench_rate(count, [&](u64 n){ res[1] = bench_save<1>(n, mask, step); });
+	printf("%-8s %8.0f -> %8.0f Mwrites/s (x%.1f)%s\n", name, rate0 / 1e6, rate1 / 1e6,
+		rate1 / rate0, memcmp(&res[0], &res[1], sizeof(A256Reg)) ? " (results differ)" : "");
+}
+
+template<typename F>
+A256Reg bench_convert_loop(std::vector<A256Reg>& data, u64 count)
+{
+	A256Reg res = A256Reg::set<u64>(0);
+	for (u64 i = 0; i < count; i++)
+	{
+		A256Reg r = F::convert(data[i & (data.size() - 1)]);
+		res = res ^ r;
+	}
+	return res;
+}
+
+template<typename Tin, typename Tout>
+void bench_convert(std::vector<A256Reg>& data, double* time, std::string& differ, const char* name) // compare with reference (checked on all inputs by test_convert())
+{
+	const u64 count = 1 << 18;
+	A256Reg res[2];
+	time[0] += count / bench_rate(count, [&](u64 n){ res[0] = bench_convert_loop<A256ConvertLanes<Tin, Tout>>(data, n); });
+	time[1] += count / bench_rate(count, [&](u64 n){ res[1] = bench_convert_loop<A256Convert<Tin, Tout>>(data, n); });
+	if (memcmp(&res[0], &res[1], sizeof(A256Reg)))
+	{
+		differ += differ.empty() ? " (results differ:" : "";
+		differ += std::string(" ") + name;
+	}
+}
+
+template<typename Tin>
+void bench_converts(const char* name, std::vector<A256Reg>& data) // Tin to every lane type
+{
+	double time[2] = {};
+	std::string differ;
+	bench_convert<Tin, u8>(data, time, differ, "ub");
+	bench_convert<Tin, s8>(data, time, differ, "sb");
+	bench_convert<Tin, u16>(data, time, differ, "uw");
+	bench_convert<Tin, s16>(data, time, differ, "sw");
+	bench_convert<Tin, u32>(data, time, differ, "ud");
+	bench_convert<Tin, s32>(data, time, differ, "sd");
+	bench_convert<Tin, u64>(data, time, differ, "uq");
+	bench_convert<Tin, s64>(data, time, differ, "sq");
+	bench_convert<Tin, f32>(data, time, differ, "fs");
+	bench_convert<Tin, f64>(data, time, differ, "fd");
+	printf("%-8s %8.0f -> %8.0f Mregs/s (x%.1f)%s%s\n", name, 10 * (1 << 18) / time[0] / 1e6, 10 * (1 << 18) / time[1] / 1e6,
+		time[0] / time[1], differ.c_str(), differ.empty() ? "" : ")");
+}
+
+template<u32 simd>
+A256Reg bench_shuffle(u64 count, std::vector<A256Reg>& masks, u32 sources) // shufb (1 source) or shufbx (4 sources)
+{
+	A256Reg data[4];
+	for (u32 i = 0; i < 32; i++)
+	{
+		data[0]._ub[i] = (u8)i;
+		data[1]._ub[i] = (u8)(i * 7);
+		data[2]._ub[i] = (u8)(i * 13);
+		data[3]._ub[i] = (u8)(i * 29);
+	}
+	for (u64 i = 0; i < count; i++)
+	{
+		A256Reg& mask = masks[i & (masks.size() - 1)];
+		if (sources == 1)
+		{
+			data[0] = simd ? A256Shuffle::shufb(mask, data[0]) : A256Shuffle::lanes(mask, data[0]);
+		}
+		else
+		{
+			data[i % 4] = simd ? A256Shuffle::shufbx(mask, data) : A256Shuffle::lanes(mask, data);
+		}
+	}
+	return data[0];
+}
+
+void bench_shuffles(const char* name, u32 sources)
+{
+	std::vector<A256Reg> masks(1024); // random masks, 1/8 of bytes zeroed
+	std::mt19937_64 rnd(1);
+	for (size_t i = 0; i < masks.size(); i++)
+	{
+		for (u32 j = 0; j < 4; j++)
+		{
+			masks[i]._uq[j] = rnd() & 0x7f7f7f7f7f7f7f7full;
+		}
+		masks[i]._ub[rnd() % 32] |= 0x80;
+		masks[i]._ub[rnd() % 32] |= 0x80;
+		masks[i]._ub[rnd() % 32] |= 0x80;
+		masks[i]._ub[rnd() % 32] |= 0x80;
+	}
+	const u64 count = 1 << 22;
+	A256Reg res[2];
+	const double rate0 = bench_rate(count, [&](u64 n){ res[0] = bench_shuffle<0>(n, masks, sources); });
+	const double rate1 = bench_rate(count, [&](u64 n){ res[1] = bench_shuffle<1>(n, masks, sources); });
+	printf("%-8s %8.0f -> %8.0f Mshuffles/s (x%.1f)%s\n", name, rate0 / 1e6, rate1 / 1e6,
+		rate1 / rate0, memcmp(&res[0], &res[1], sizeof(A256Reg)) ? " (results differ)" : "");
+}
+
+template<typename T, u32 simd>
+A256Reg bench_gather(u64 count, std::vector<T>& table) // chained lookups: loaded values are the next indices
+{
+	A256Reg index;
+	for (u32 i = 0; i < 32 / sizeof(T); i++)
+	{
+		index.get<T>(i) = (T)(i * 97);
+	}
+	for (u64 i = 0; i < count; i++)
+	{
+		index = simd ? A256Gather<T>::gather(index, (u64)table.data(), index, 0xff, 0, ~0ull)
+			: A256GatherLanes<T>::gather(index, (u64)table.data(), index, 0xff, 0, ~0ull);
+	}
+	return index;
+}
+
+template<typename T>
+void bench_gathers(const char* name)
+{
+	std::vector<T> table(1 << 16); // random indices into itself (256 or 512 KiB)
+	std::mt19937_64 rnd(1);
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		table[i] = (T)(rnd() % table.size());
+	}
+	const u64 count = 1 << 22;
+	A256Reg res[2];
+	const double rate0 = bench_rate(count, [&](u64 n){ res[0] = bench_gather<T, 0>(n, table); });
+	const double rate1 = bench_rate(count, [&](u64 n){ res[1] = bench_gather<T, 1>(n, table); });
+	printf("%-8s %8.0f -> %8.0f Mlanes/s (x%.1f)%s\n", name, rate0 * (32 / sizeof(T)) / 1e6, rate1 * (32 / sizeof(T)) / 1e6,
+		rate1 / rate0, memcmp(&res[0], &res[1], sizeof(A256Reg)) ? " (results differ)" : "");
+}
+
+void bench_batch(u32 threads, const A256Machine::A256Threaded& program, const std::vector<std::vector<A256Reg>>& inputs)
+{
+	A256Batch batch(threads);
+	std::vector<A256Batch::A256Result> res;
+	const double rate = bench_rate(1, [&](u64){ res = batch.run(program, inputs); });
+	size_t errors = 0;
+	for (size_t i = 0; i < res.size(); i++)
+	{
+		const u64 n = inputs[i][0]._ud[0];
+		if (!res[i].error.empty() || res[i].exit_status != (s64)(n * (n - 1) / 2))
+		{
+			errors++;
+		}
+	}
+	printf("%2u thread(s): %8.0f jobs/s%s\n", threads, rate * inputs.size(), errors ? " (wrong results)" : "");
+}
+
+void bench_loop(A256Machine& vm, const char* name, const char* text, u64 count) // interpreter vs JIT, iterations per second
+{
+	const std::vector<A256Cmd> code = vm.compile(text);
+	const auto program = vm.decode(code);
+	A256Jit jit(vm, program);
+	double rate[2];
+	for (u32 native = 0; native < 2; native++)
+	{
+		vm.reg[0]._uq[0] = (u64)code.data(); // $NP
+		vm.reg[1]._ud[0] = (u32)count;
+		rate[native] = bench_rate(count, [&](u64){ if (native) jit.run(vm); else vm.run(program); });
+	}
+	printf("%-8s %8.0f -> %8.0f Miter/s (x%.1f)\n", name, rate[0] / 1e6, rate[1] / 1e6, rate[1] / rate[0]);
+}
+
+void bench_simple_loop(A256Machine& vm, u64 count) // SimpleLoop (A256Samples.h) as is and with loopd, interpreter vs JIT, iterations per second
+{
+	const std::string loop = "subd $01.ud0, $01.ud0, 1; decrement\njrnz $01.ud0, @SimpleLoop; check counter\n";
+	std::string fused = simple_loop;
+	fused.replace(fused.find(loop), loop.size(), "loopd $01.ud0, @SimpleLoop; decrement and check counter\n");
+	const auto sink = vm.sink;
+	vm.sink = [](void*, const char*, size_t) {}; // output of stop 11, 12 and 14
+	const std::string texts[2] = { simple_loop, fused };
+	for (u32 i = 0; i < 2; i++)
+	{
+		std::vector<A256Machine::A256Symbol> symbols;
+		const std::vector<A256Cmd> code = vm.compile(texts[i], &symbols);
+		const auto entry = std::find_if(symbols.begin(), symbols.end(), [](const A256Machine::A256Symbol& s) { return s.name == "@SimpleLoop"; });
+		const auto program = vm.decode(code);
+		A256Jit jit(vm, program);
+		double rate[2];
+		for (u32 native = 0; native < 2; native++)
+		{
+			// entered at the label with the counter of the host ("0x02;ffffff" sets 2, ';' starts a comment)
+			vm.reg[0]._uq[0] = (u64)(code.data() + entry->value); // $NP
+			vm.reg[1]._ud[0] = (u32)count;
+			rate[native] = bench_rate(count, [&](u64){ if (native) jit.run(vm); else vm.run(program); });
+		}
+		vm.flush();
+		printf("%-8s %8.0f -> %8.0f Miter/s (x%.1f)\n", i ? "loopd" : "jrnz", rate[0] / 1e6, rate[1] / 1e6, rate[1] / rate[0]);
+	}
+	vm.sink = sink;
+}
+
+void bench_optimize(A256Machine& vm, const char* name, const char* text, u64 count) // compile() vs optimize() output, iterations per second
+{
+	const std::vector<A256Cmd> code[2] = { vm.compile(text), vm.optimize(vm.compile(text)) };
+	double rate[2];
+	s64 res[2];
+	for (u32 opt = 0; opt < 2; opt++)
+	{
+		const auto program = vm.decode(code[opt]);
+		memset(vm.reg, 0, sizeof(vm.reg));
+		vm.reg[0]._uq[0] = (u64)code[opt].data(); // $NP
+		vm.reg[1]._ud[0] = (u32)count;
+		rate[opt] = bench_rate(count, [&](u64){ vm.run(program); });
+		res[opt] = vm.exit_status;
+	}
+	printf("%-8s %8.0f -> %8.0f Miter/s (x%.1f, %lld -> %lld instructions)%s\n", name, rate[0] / 1e6, rate[1] / 1e6, rate[1] / rate[0],
+		(u64)code[0].size(), (u64)code[1].size(), res[0] != res[1] ? " (results differ)" : "");
+}
+
+void bench_fuse(A256Machine& vm, const char* name, const char* text, u64 count) // optimize() output without and with superinstructions, iterations per second
+{
+	std::vector<A256Cmd> code[2] = { vm.optimize(vm.compile(text)), vm.optimize(vm.compile(text)) };
+	size_t fused = 0;
+	for (auto& cmd : code[0])
+	{
+		for (const auto& f : vm.instr.fusions)
+		{
+			if (cmd.cmd == f.code)
+			{
+				cmd.cmd = f.seq[0];
+				fused++;
+			}
+		}
+	}
+	std::vector<u256> table(0x100);
+	double rate[2];
+	s64 res[2];
+	for (u32 fuse = 0; fuse < 2; fuse++)
+	{
+		const auto program = vm.decode(code[fuse]);
+		memset(vm.reg, 0, sizeof(vm.reg));
+		for (size_t i = 0; i < table.size(); i++)
+		{
+			table[i] = _mm256_set1_epi32((int)(i % 7));
+		}
+		vm.reg[0]._uq[0] = (u64)code[fuse].data(); // $NP
+		vm.reg[1]._ud[0] = (u32)count;
+		vm.reg[2] = A256Reg::set<u64>((u64)table.data());
+		rate[fuse] = bench_rate(count, [&](u64){ vm.run(program); });
+		res[fuse] = vm.exit_status;
+	}
+	printf("%-8s %8.0f -> %8.0f Miter/s (x%.1f, %lld superinstructions)%s\n", name, rate[0] / 1e6, rate[1] / 1e6, rate[1] / rate[0],
+		(u64)fused, res[0] != res[1] ? " (results differ)" : "");
+}
+
+void bench_copy(A256Machine& vm, const char* name, u64 size) // copy loop (ld, stm) vs blkcpy, bytes per second
+{
+	std::vector<u256> src(size / 32), dst(size / 32);
+	memset(src.data(), 0x5a, size);
+	const char* text[2] = {
+		"@Loop:\n"
+		"subd $03.ud0, $03.ud0, 32\n"
+		"ld $04, $01.uq0, $03.uq0\n"
+		"stm $04, $02.uq0, $03.uq0\n"
+		"jrnz $03.ud0, @Loop\n"
+		"stop $00, 0\n",
+		"blkcpy $02.uq0, $01.uq0, $03.uq0\n"
+		"stop $00, 0\n" };
+	const u64 count = std::max<u64>((1ull << 30) / size, 1);
+	double rate[2];
+	for (u32 block = 0; block < 2; block++)
+	{
+		const std::vector<A256Cmd> code = vm.compile(text[block]);
+		const auto program = vm.decode(code);
+		rate[block] = bench_rate(count, [&](u64 n)
+		{
+			for (u64 i = 0; i < n; i++)
+			{
+				vm.reg[0]._uq[0] = (u64)code.data(); // $NP
+				vm.reg[1] = A256Reg::set<u64>((u64)src.data());
+				vm.reg[2] = A256Reg::set<u64>((u64)dst.data());
+				vm.reg[3] = A256Reg::set<u64>(size);
+				vm.run(program);
+			}
+		});
+	}
+	printf("%-8s %8.0f -> %8.0f MB/s (x%.1f)%s\n", name, rate[0] * size / 1e6, rate[1] * size / 1e6, rate[1] / rate[0],
+		memcmp(src.data(), dst.data(), size) ? " (results differ)" : "");
+}
+
+double bench_scheduler(const A256Machine::A256Threaded& program, u32 tasks, u64 slice, u64 iterations) // instructions per second
+{
+	A256Scheduler scheduler(std::max<u32>(std::thread::hardware_concurrency(), 1), slice);
+	std::vector<std::unique_ptr<A256Machine>> vms(tasks);
+	for (auto& vm : vms)
+	{
+		vm.reset(new A256Machine);
+		vm->reg[0]._uq[0] = (u64)program.base; // $NP
+		vm->reg[1]._ud[0] = (u32)iterations;
+	}
+	const double rate = bench_rate(1, [&](u64)
+	{
+		for (auto& vm : vms)
+		{
+			scheduler.add(*vm, program);
+		}
+		scheduler.wait();
+	});
+	return rate * tasks * iterations * 2; // two instructions per iteration
+}
+
+void bench_fork(const char* name, u64 size) // setup per instance vs fork of snapshot taken after setup, instances per second
+{
+	std::unique_ptr<A256Machine> machine(new A256Machine), forked(new A256Machine);
+	A256Machine& vm = *machine;
+	const std::vector<A256Cmd> code = vm.compile(
+		"@Fill:\n" // table of $01.uq0 bytes at guest address 0x10000
+		"subd $01.ud0, $01.ud0, 32\n"
+		"addd $04, $04, 1\n"
+		"stm $04, $02.uq0, $01.uq0\n"
+		"jrnz $01.ud0, @Fill\n"
+		"stop $00, 0\n"
+		"ld $05, $02.uq0, $03.uq0\n" // request: increment table entry $03.uq0
+		"addd $05, $05, 1\n"
+		"stm $05, $02.uq0, $03.uq0\n"
+		"stop $00, 0\n");
+	A256Memory memory(0x10000 + size + 0x20000);
+	A256Memory target(memory.size);
+	A256Machine& instance = *forked;
+	const u64 count = std::max<u64>(0x10000000 / size, 16);
+	double rate[2];
+	for (u32 fork = 0; fork < 2; fork++)
+	{
+		const auto program = memory.load(vm, code); // forks share the decoded program
+		vm.reg[1] = A256Reg::set<u64>(size);
+		vm.reg[2] = A256Reg::set<u64>(0x10000);
+		vm.run(program); // setup
+		A256Snapshot snapshot(vm);
+		rate[fork] = bench_rate(count, [&](u64 n)
+		{
+			for (u64 i = 0; i < n; i++)
+			{
+				if (fork)
+				{
+					target.fork(instance, snapshot);
+				}
+				else
+				{
+					target.load(instance, code);
+					instance.reg[1] = A256Reg::set<u64>(size);
+					instance.reg[2] = A256Reg::set<u64>(0x10000);
+					instance.run(program);
+				}
+				instance.reg[3] = A256Reg::set<u64>(i * 32 % size);
+				instance.run(program);
+			}
+		});
+	}
+	printf("%-8s %8.0f -> %8.0f instances/s (x%.1f)\n", name, rate[0], rate[1], rate[1] / rate[0]);
+}
+
+#define BENCH_ARITH(f, T, t) bench_kernels<T, &A256Lanes<T>::f, &A256Simd<T>::f>(#f " " t)
+#define BENCH_SHIFT(f, T, t) bench_kernels<T, &A256ShiftLanes<T>::f, &A256Shift<T>::f>(#f t)
+#define BENCH_WIDE(f) bench_kernels<u64, &A256WideLanes::f, &A256Wide::f>(#f)
+
+void bench()
+{
+	printf("Element-wise arithmetic and compares (A256Lanes -> A256Simd):\n");
+	BENCH_ARITH(add, f32, "fs");
+	BENCH_ARITH(add, f64, "fd");
+	BENCH_ARITH(add, s8, "b");
+	BENCH_ARITH(add, s16, "w");
+	BENCH_ARITH(add, s32, "d");
+	BENCH_ARITH(add, s64, "q");
+	BENCH_ARITH(sub, f32, "fs");
+	BENCH_ARITH(sub, f64, "fd");
+	BENCH_ARITH(sub, s8, "b");
+	BENCH_ARITH(sub, s16, "w");
+	BENCH_ARITH(sub, s32, "d");
+	BENCH_ARITH(sub, s64, "q");
+	BENCH_ARITH(mul, f32, "fs");
+	BENCH_ARITH(mul, f64, "fd");
+	BENCH_ARITH(mul, s8, "b");
+	BENCH_ARITH(mul, s16, "w");
+	BENCH_ARITH(mul, s32, "d");
+	BENCH_ARITH(mul, s64, "q");
+	BENCH_ARITH(mulh, s8, "sb");
+	BENCH_ARITH(mulh, s16, "sw");
+	BENCH_ARITH(mulh, s32, "sd");
+	BENCH_ARITH(mulh, s64, "sq");
+	BENCH_ARITH(mulh, u8, "ub");
+	BENCH_ARITH(mulh, u16, "uw");
+	BENCH_ARITH(mulh, u32, "ud");
+	BENCH_ARITH(mulh, u64, "uq");
+	BENCH_ARITH(ceq, f32, "fs");
+	BENCH_ARITH(ceq, f64, "fd");
+	BENCH_ARITH(ceq, s8, "b");
+	BENCH_ARITH(ceq, s16, "w");
+	BENCH_ARITH(ceq, s32, "d");
+	BENCH_ARITH(ceq, s64, "q");
+	BENCH_ARITH(cgt, f32, "fs");
+	BENCH_ARITH(cgt, f64, "fd");
+	BENCH_ARITH(cgt, s8, "sb");
+	BENCH_ARITH(cgt, s16, "sw");
+	BENCH_ARITH(cgt, s32, "sd");
+	BENCH_ARITH(cgt, s64, "sq");
+	BENCH_ARITH(cgt, u8, "ub");
+	BENCH_ARITH(cgt, u16, "uw");
+	BENCH_ARITH(cgt, u32, "ud");
+	BENCH_ARITH(cgt, u64, "uq");
+	BENCH_ARITH(min, f32, "fs");
+	BENCH_ARITH(min, f64, "fd");
+	BENCH_ARITH(min, s8, "sb");
+	BENCH_ARITH(min, s16, "sw");
+	BENCH_ARITH(min, s32, "sd");
+	BENCH_ARITH(min, s64, "sq");
+	BENCH_ARITH(min, u8, "ub");
+	BENCH_ARITH(min, u16, "uw");
+	BENCH_ARITH(min, u32, "ud");
+	BENCH_ARITH(min, u64, "uq");
+	BENCH_ARITH(max, f32, "fs");
+	BENCH_ARITH(max, f64, "fd");
+	BENCH_ARITH(max, s8, "sb");
+	BENCH_ARITH(max, s16, "sw");
+	BENCH_ARITH(max, s32, "sd");
+	BENCH_ARITH(max, s64, "sq");
+	BENCH_ARITH(max, u8, "ub");
+	BENCH_ARITH(max, u16, "uw");
+	BENCH_ARITH(max, u32, "ud");
+	BENCH_ARITH(max, u64, "uq");
+
+	printf("Shifts and rotates (A256ShiftLanes -> A256Shift, A256WideLanes -> A256Wide):\n");
+	BENCH_SHIFT(sll, u8, "b");
+	BENCH_SHIFT(sll, u16, "w");
+	BENCH_SHIFT(sll, u32, "d");
+	BENCH_SHIFT(sll, u64, "q");
+	BENCH_WIDE(slldq);
+	BENCH_WIDE(sllqq);
+	BENCH_SHIFT(slr, u8, "b");
+	BENCH_SHIFT(slr, u16, "w");
+	BENCH_SHIFT(slr, u32, "d");
+	BENCH_SHIFT(slr, u64, "q");
+	BENCH_WIDE(slrdq);
+	BENCH_WIDE(slrqq);
+	BENCH_SHIFT(sar, u8, "b");
+	BENCH_SHIFT(sar, u16, "w");
+	BENCH_SHIFT(sar, u32, "d");
+	BENCH_SHIFT(sar, u64, "q");
+	BENCH_WIDE(sardq);
+	BENCH_WIDE(sarqq);
+	BENCH_SHIFT(rl, u8, "b");
+	BENCH_SHIFT(rl, u16, "w");
+	BENCH_SHIFT(rl, u32, "d");
+	BENCH_SHIFT(rl, u64, "q");
+	BENCH_WIDE(rldq);
+	BENCH_WIDE(rlqq);
+
+	printf("Register write-back (RSAVE1 loop -> A256Reg::save):\n");
+	bench_saves("mask ff", 0xff, 0);
+	bench_saves("mixed", 0x35, 1);
+
+	printf("Byte shuffles (A256Shuffle::lanes -> A256Shuffle):\n");
+	bench_shuffles("shufb", 1);
+	bench_shuffles("shufbx", 4);
+
+	printf("Gathers (A256GatherLanes -> A256Gather):\n");
+	bench_gathers<u32>("gatherd");
+	bench_gathers<u64>("gatherq");
+
+	printf("bsc1 conversions (A256ConvertLanes -> A256Convert, all lane types):\n");
+	std::vector<A256Reg> data = convert_samples();
+	bench_converts<u8>("getub", data);
+	bench_converts<s8>("getsb", data);
+	bench_converts<u16>("getuw", data);
+	bench_converts<s16>("getsw", data);
+	bench_converts<u32>("getud", data);
+	bench_converts<s32>("getsd", data);
+	bench_converts<u64>("getuq", data);
+	bench_converts<s64>("getsq", data);
+	bench_converts<f32>("getfss", data);
+	bench_converts<f64>("getfds", data);
+
+	printf("Batch runner (jobs of uneven length):\n");
+	std::unique_ptr<A256Machine> machine(new A256Machine); // on the heap like A256Batch workers
+	A256Machine& vm = *machine;
+	const std::vector<A256Cmd> code = vm.compile(
+		"@Loop:\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"addd $02.ud0, $02.ud0, $01.ud0\n"
+		"jrnz $01.ud0, @Loop\n"
+		"stop $02.sq0, 0\n");
+	const auto program = vm.decode(code);
+	std::vector<std::vector<A256Reg>> inputs(20000, std::vector<A256Reg>(1));
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		inputs[i][0]._ud[0] = (u32)(i * i % 2000) + 1; // loop count
+	}
+	const u32 cores = std::max<u32>(std::thread::hardware_concurrency(), 1);
+	for (u32 threads = 1; threads < cores; threads *= 2)
+	{
+		bench_batch(threads, program, inputs);
+	}
+	bench_batch(cores, program, inputs);
+
+	printf("Scheduler (4 tasks per thread, run to completion -> time slices):\n");
+	const std::vector<A256Cmd> spin = vm.compile(
+		"@Loop:\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @Loop\n"
+		"stop $00, 0\n");
+	const auto spin_program = vm.decode(spin);
+	const double whole = bench_scheduler(spin_program, cores * 4, ~0ull, 1 << 22);
+	for (u64 slice = 0x100; slice <= 0x10000; slice *= 0x10)
+	{
+		const double rate = bench_scheduler(spin_program, cores * 4, slice, 1 << 22);
+		printf("0x%-6llx %8.0f -> %8.0f Minstr/s (x%.2f)\n", slice, whole / 1e6, rate / 1e6, rate / whole);
+	}
+
+	printf("Instances (setup code per instance -> fork of snapshot, table size):\n");
+	bench_fork("4 KiB", 0x1000);
+	bench_fork("256 KiB", 0x40000);
+
+	printf("Block copy (ld/stm loop -> blkcpy):\n");
+	bench_copy(vm, "4 KiB", 0x1000);
+	bench_copy(vm, "256 KiB", 0x40000);
+	bench_copy(vm, "16 MiB", 0x1000000);
+
+	printf("Peephole optimizer (compile -> optimize, $01.ud0 iterations):\n");
+	bench_optimize(vm, "dead", // results overwritten before use
+		"@Loop:\n"
+		"setd $02, 0\n"
+		"addd $02, $01, $01\n"
+		"setd $02, 3\n"
+		"addd $03, $03, $02\n"
+		"loopd $01.ud0, @Loop\n"
+		"stop $03.sq0, 0\n", 1 << 24);
+	bench_optimize(vm, "fold", // setd + adddi, mmovb pairs
+		"@Loop:\n"
+		"setd $02, 3\n"
+		"adddi $02, 4\n"
+		"mmovb $04, $02, 0x0f\n"
+		"mmovb $04, $02, 0xf000\n"
+		"addd $03, $03, $04\n"
+		"loopd $01.ud0, @Loop\n"
+		"stop $03.sq0, 0\n", 1 << 24);
+	bench_optimize(vm, "jumps", // jump chains and jumps to the next instruction
+		"@Loop:\n"
+		"addd $03, $03, $01\n"
+		"j @Next\n"
+		"@Next:\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrz $01.ud0, @Exit\n"
+		"j @Loop\n"
+		"@Exit:\n"
+		"j @End\n"
+		"@End:\n"
+		"stop $03.sq0, 0\n", 1 << 24);
+
+	printf("Superinstructions (optimize without -> with A256Fused.h, $01.ud0 iterations):\n");
+	bench_fuse(vm, "jrnz", // decrement and test
+		"@Loop:\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @Loop\n"
+		"stop $01.sq0, 0\n", 1 << 24);
+	bench_fuse(vm, "muladd", // polynomial step
+		"setd $03, 3\n"
+		"@Loop:\n"
+		"muld $04, $04, $03\n"
+		"addd $04, $04, $01\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @Loop\n"
+		"stop $04.sq0, 0\n", 1 << 24);
+	bench_fuse(vm, "select", // replace matching table entries
+		"setd $07, 3\n"
+		"setd $08, 0\n"
+		"setd $05, 0\n"
+		"@Loop:\n"
+		"andd $05.ud0, $01.ud0, 255\n"
+		"muld $05.ud0, $05.ud0, 32\n"
+		"ld $04, $02.uq0, $05.uq0\n"
+		"ceqd $06, $04, $07\n"
+		"cmovd $04, $06, $08\n"
+		"stm $04, $02.uq0, $05.uq0\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @Loop\n"
+		"stop $04.sq0, 0\n", 1 << 22);
+
+	printf("Loops (interpreter -> JIT, SimpleLoop of A256Test.cpp, $01.ud0 iterations):\n");
+	const u64 iterations = 1 << 25;
+	bench_simple_loop(vm, iterations);
+	bench_loop(vm, "jrltud", // count up to limit
+		"setd $02.ud0, 0\n"
+		"@Loop:\n"
+		"addd $02.ud0, $02.ud0, 1\n"
+		"jrltud $02.ud0, $01.ud0, @Loop\n"
+		"stop $00, 0\n", iterations);
+}
+
+#undef BENCH_ARITH
+#undef BENCH_SHIFT
+#undef BENCH_WIDE
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <random>
+#include "../A256Core/A256Simd.h"
+
+// sample programs and data shared by A256Test (program run without arguments), the tests and the benchmarks
+
+static const char* const simple_loop =
+	"setd $01.ud0, 0x02;ffffff; initialize counter\n"
+	"@SimpleLoop:\n"
+	"subd $01.ud0, $01.ud0, 1; decrement\n"
+	"jrnz $01.ud0, @SimpleLoop; check counter\n"
+	"stop $01, 11; show register data\n"
+	"addr $01.uq0, @HelloWorld; set text pointer\n"
+	"setd $01.ud2, 15; set text length\n"
+	"setd $01.ud3, 0; fix text length\n"
+	"stop $01, 12; print text\n"
+	"stop 0, 14\n"
+	"stop $00, 0\n"
+	"@HelloWorld:\n"
+	"d 'Hello, w'\n"
+	"d 'orld!\\n'\n";
+
+std::vector<A256Reg> convert_samples() // bounds of every type, then random bits, integers and fractions
+{
+	std::vector<A256Reg> data;
+	const f32 fs[] = { 0.5f, -0.5f, 1.5f, -1.5f, 127.5f, -128.5f, 255.5f, 32767.5f, -32768.5f, 65535.5f, 2147483648.0f, -2147483904.0f,
+		4294967040.0f, 4294967296.0f, 1e20f, -1e20f, FLT_MAX, -FLT_MAX, FLT_MIN, std::numeric_limits<f32>::infinity(), -std::numeric_limits<f32>::infinity(),
+		std::numeric_limits<f32>::quiet_NaN() };
+	const f64 fd[] = { 0.5, -0.5, 255.5, 2147483647.5, -2147483648.5, 4294967295.5, 9223372036854775808.0, -9223372036854777856.0,
+		18446744073709551616.0, 1e300, -1e300, std::numeric_limits<f64>::infinity(), std::numeric_limits<f64>::quiet_NaN() };
+	const s64 sq[] = { 0, 1, -1, 127, 128, -128, -129, 255, 256, 32767, 32768, -32768, -32769, 65535, 65536, INT_MAX, INT_MIN, UINT_MAX,
+		(s64)UINT_MAX + 1, LLONG_MAX, LLONG_MIN };
+	for (auto x : fs) data.push_back(A256Reg::set(x));
+	for (auto x : fd) data.push_back(A256Reg::set(x));
+	for (auto x : sq)
+	{
+		data.push_back(A256Reg::set<s8>((s8)x));
+		data.push_back(A256Reg::set<s16>((s16)x));
+		data.push_back(A256Reg::set<s32>((s32)x));
+		data.push_back(A256Reg::set<s64>(x));
+	}
+	std::mt19937_64 rnd(0);
+	while (data.size() < 4096) // power of 2 (see bench_convert_loop())
+	{
+		A256Reg r;
+		for (u32 i = 0; i < 4; i++)
+		{
+			r._uq[i] = rnd();
+		}
+		switch (data.size() % 4)
+		{
+		case 1: for (u32 i = 0; i < 8; i++) r._sd[i] = (s32)rnd() >> (rnd() % 32); break;
+		case 2: for (u32 i = 0; i < 8; i++) r._fs[i] = (s32)rnd() / (f32)(1 << (rnd() % 32)); break;
+		case 3: for (u32 i = 0; i < 4; i++) r._fd[i] = (s64)rnd() / (f64)(1ull << (rnd() % 64)); break;
+		}
+		data.push_back(r);
+	}
+	return data;
+}
+
+std::vector<A256Reg>& convert_words() // every 16-bit value in every word lane, so every 8-bit value in every byte lane
+{
+	static std::vector<A256Reg> words;
+	if (words.empty())
+	{
+		words.resize(0x10000);
+		for (u32 k = 0; k < 0x10000; k++)
+		{
+			for (u32 j = 0; j < 16; j++)
+			{
+				words[k]._uw[j] = (u16)(k + j);
+			}
+		}
+	}
+	return words;
+}
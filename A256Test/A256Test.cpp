@@ -11,34 +11,36 @@
 #include <streambuf>
 #include <codecvt>
 
-#include "../A256Core/A256Interpreter.h"
+#include "../A256Core/A256Jit.h"
+#include "../A256Core/A256Image.h"
+#include "A256Samples.h"
+#include "A256Bench.h"
+#include "A256Tests.h"
 
 A256Machine vm;
 
 int _tmain(int argc, _TCHAR* argv[])
 {
-	std::string text =
-		"setd $01.ud0, 0x02;ffffff; initialize counter\n"
-		"@SimpleLoop:\n"
-		"subd $01.ud0, $01.ud0, 1; decrement\n"
-		"jrnz $01.ud0, @SimpleLoop; check counter\n"
-		"stop $01, 11; show register data\n"
-		"addr $01.uq0, @HelloWorld; set text pointer\n"
-		"setd $01.ud2, 15; set text length\n"
-		"setd $01.ud3, 0; fix text length\n"
-		"stop $01, 12; print text\n"
-		"stop 0, 14\n"
-		"stop $00, 0\n"
-		"@HelloWorld:\n"
-		"d 'Hello, w'\n"
-		"d 'orld!\\n'\n";
+	std::string text = simple_loop;
 
 	std::vector<A256Cmd> program;
+	A256Image image; // cached binary image of loaded file
+	const A256Cmd* code = nullptr;
+	size_t size = 0;
 	std::vector<u256> stack(1024 * 128);
 	std::vector<u64> cstack(1024 * 128);
 
 	try
 	{
+		if (argc > 1 && !_tcscmp(argv[1], _T("-bench")))
+		{
+			bench();
+			return 0;
+		}
+		if (argc > 1 && !_tcscmp(argv[1], _T("-test")))
+		{
+			return tests() ? 1 : 0;
+		}
 		if (argc > 1)
 		{
 			std::wstring_convert<std::codecvt_utf8<_TCHAR>, _TCHAR> convert;
@@ -48,6 +50,16 @@ int _tmain(int argc, _TCHAR* argv[])
 			{
 				text = std::string(std::istreambuf_iterator<char>(t), std::istreambuf_iterator<char>());
 				printf("'%s' loaded.\n", name.c_str());
+				if (image.load(vm, text, name + ".a256o"))
+				{
+					printf("Cached image used (%lld instructions).\n", (u64)image.size);
+				}
+				else
+				{
+					printf("%lld instructions generated (%s).\n", (u64)image.size, image.header ? "image saved" : "image not saved");
+				}
+				code = image.code;
+				size = image.size;
 			}
 			else
 			{
@@ -58,16 +70,34 @@ int _tmain(int argc, _TCHAR* argv[])
 		{
 			printf("%s", text.c_str());
 		}
-		printf("Compiling...\n");
-		program = vm.compile(text);
-		printf("%lld instructions generated.\n", program.size());
+		if (!code)
+		{
+			printf("Compiling...\n");
+			program = vm.compile(text);
+			printf("%lld instructions generated.\n", program.size());
+			code = program.data();
+			size = program.size();
+		}
+#ifdef A256_PROFILE
+		std::vector<u64> lines;
+		vm.compile(text, nullptr, nullptr, &lines); // source lines for the report (image has none)
+#endif
+		const auto threaded = vm.decode(code, size);
+		A256Jit jit(vm, threaded);
 		printf("Executing...\n");
-		vm.reg[0]._uq[0] = (u64)program.data(); // $NP
+		vm.reg[0]._uq[0] = (u64)code; // $NP
 		vm.reg[0]._uq[1] = (u64)cstack.data() + sizeof(cstack[0]) * cstack.size(); // $CS
 		vm.reg[0]._uq[2] = (u64)stack.data() + sizeof(stack[0]) * stack.size(); // $BP
 		vm.reg[0]._uq[3] = vm.reg[0]._uq[2]; // $SP
-		while (vm.execute());
+		if (jit.run(vm))
+		{
+			throw vm.fault_message();
+		}
 		printf("Program finished.\n");
+#ifdef A256_PROFILE
+		vm.profile.report(vm.instr.name, code, text, lines);
+		printf("Superinstructions (see A256Fused.h):\n%s", vm.profile.fusions(vm.instr).c_str());
+#endif
 	}
 	catch (size_t& x)
 	{
@@ -103,7 +133,7 @@ int _tmain(int argc, _TCHAR* argv[])
 		printf("Unknown error.\n");
 	}
 	printf("$NP = 0x%llx (program = 0x%llx, position = %lld)\n",
-		vm.reg[0]._uq[0], (u64)program.data(), (vm.reg[0]._uq[0] - (u64)program.data()) / sizeof(u64));
+		vm.reg[0]._uq[0], (u64)code, (vm.reg[0]._uq[0] - (u64)code) / sizeof(u64));
 	return 0;
 }
 
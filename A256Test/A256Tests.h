@@ -0,0 +1,436 @@
+#pragma once
+
+#include <random>
+#include <atomic>
+#include "../A256Core/A256Jit.h"
+#include "../A256Core/A256Image.h"
+#include "../A256Core/A256Scheduler.h"
+#include "../A256Core/A256Memory.h"
+#include "A256Samples.h"
+
+// correctness checks (A256Test -test), every test returns the number of failures
+
+struct A256TestRun // machine with stacks, runs compiled program from its start
+{
+	A256Machine vm;
+	std::vector<u256> stack;
+	std::vector<u64> cstack;
+
+	A256TestRun()
+		: stack(1024)
+		, cstack(1024)
+	{
+	}
+
+	void start(const std::vector<A256Cmd>& code) // registers for a run from the first instruction
+	{
+		memset(vm.reg, 0, sizeof(vm.reg));
+		vm.exit_status = 0;
+		vm.reg[0]._uq[0] = (u64)code.data(); // $NP
+		vm.reg[0]._uq[1] = (u64)(cstack.data() + cstack.size()); // $CS
+		vm.reg[0]._uq[2] = (u64)(stack.data() + stack.size()); // $BP
+		vm.reg[0]._uq[3] = vm.reg[0]._uq[2]; // $SP
+	}
+
+	u32 run(const std::vector<A256Cmd>& code, bool jit = false, u64 budget = 1000000)
+	{
+		const auto program = vm.decode(code);
+		start(code);
+		if (jit)
+		{
+			A256Jit native(vm, program);
+			return native.run(vm, budget);
+		}
+		return vm.run(program, budget);
+	}
+};
+
+u32 test_optimize_same(const std::string& text, bool verbose = false) // compile() and optimize() output give the same registers
+{
+	A256TestRun a, b;
+	std::vector<A256Machine::A256Symbol> symbols;
+	std::vector<A256Machine::A256Link> links;
+	std::vector<u64> lines;
+	const auto code = a.vm.compile(text, &symbols, &links, &lines);
+	const auto opt = a.vm.optimize(code, &symbols, &links, &lines);
+	const u32 fa = a.run(code);
+	const u32 fb = b.run(opt);
+	if (fa == A256Machine::faultBudget && fb == A256Machine::faultBudget)
+	{
+		return 0; // endless loop
+	}
+	// $00 holds addresses of the two copies
+	const bool same = fa == fb && a.vm.exit_status == b.vm.exit_status && !memcmp(&a.vm.reg[1], &b.vm.reg[1], sizeof(A256Reg) * 255) && lines.size() == opt.size();
+	if (!same || verbose)
+	{
+		printf("%s%lld -> %lld instructions, fault %u/%u, exit %lld/%lld%s\n", same ? "" : text.c_str(),
+			(u64)code.size(), (u64)opt.size(), fa, fb, a.vm.exit_status, b.vm.exit_status, same ? "" : " (DIFFERENT)");
+	}
+	return !same;
+}
+
+u32 test_optimize()
+{
+	u32 failures = 0;
+	// jrnz 0 is never taken, so the j after it is live and must be moved with the removed dead store
+	failures += test_optimize_same(
+		"setd $01, 4\n"
+		"jrnz 0, @A\n"
+		"j @B\n"
+		"@A:\n"
+		"setd $02, 1\n"
+		"setd $02, 2\n"
+		"@B:\n"
+		"addd $03, $02, $01\n"
+		"stop $03.sq0, 0\n");
+	// jrz 0 is always taken
+	failures += test_optimize_same(
+		"setd $01, 4\n"
+		"jrz 0, @A\n"
+		"setd $01, 5\n"
+		"@A:\n"
+		"setd $02, 1\n"
+		"setd $02, 2\n"
+		"j @B\n"
+		"@B:\n"
+		"addd $03, $02, $01\n"
+		"stop $03.sq0, 0\n");
+
+	// random straight code with labels, conditional and unconditional jumps, $05 counts the backward jumps down
+	std::mt19937 rnd(1);
+	const auto next = [&](u32 n) { return (u32)(rnd() % n); };
+	const char* const ops[] = { "addd", "subd", "xord", "muld", "andq", "orw" };
+	const char* const masks[] = { "", ".ud0", ".ud1", ".uq1", ".15" };
+	for (u32 n = 0; n < 3000; n++)
+	{
+		std::string text = "setd $05, 0\nsetd $05.ud0, 3\n";
+		std::vector<u32> labels;
+		const u32 length = 5 + next(30);
+		for (u32 i = 0; i < length; i++)
+		{
+			const u32 r = 1 + next(4);
+			const u32 a = 1 + next(4);
+			const u32 b = 1 + next(4);
+			switch (next(11))
+			{
+			case 0:
+			case 1: text += fmt::format("setd $%02x%s, %u\n", r, masks[next(5)], next(100)); break;
+			case 2: text += fmt::format("adddi $%02x%s, %u\n", r, masks[next(5)], next(3)); break;
+			case 3: text += fmt::format("mmovb $%02x, $%02x, 0x%x\n", r, a, next(2) ? (u32)rnd() : next(0x100)); break;
+			case 4: text += fmt::format("@L%u:\n", i); labels.push_back(i); break;
+			case 5:
+				if (!labels.empty())
+				{
+					text += fmt::format("subd $05.ud0, $05.ud0, 1\njrnz $05.ud0, @L%u\n", labels[next((u32)labels.size())]);
+				}
+				break;
+			case 6: text += fmt::format("j @N%u\n@N%u:\n", i, i); break;
+			case 7: text += fmt::format("%s 0, @N%u\nsetd $%02x, %u\n@N%u:\n", next(2) ? "jrnz" : "jrz", i, r, next(100), i); break;
+			default: text += fmt::format("%s $%02x%s, $%02x, $%02x\n", ops[next(6)], r, masks[next(5)], a, b); break;
+			}
+		}
+		text += "stop $01.sq0, 0\n";
+		failures += test_optimize_same(text);
+	}
+	return failures;
+}
+
+u32 test_fused() // superinstructions are charged all their parts, data is not un-fused
+{
+	u32 failures = 0;
+	A256TestRun t;
+	auto code = t.vm.compile(
+		"setd $01.ud0, 100\n"
+		"@L:\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @L\n"
+		"stop $01.sq0, 0\n");
+	A256Cmd data = code.back();
+	data.cmd = t.vm.instr.fusions.front().code; // word after the code that looks like a superinstruction
+	code.push_back(data);
+	const auto opt = t.vm.optimize(code);
+	failures += opt.size() != code.size() || opt[1].cmd == code[1].cmd; // subd+jrnz fused
+	failures += memcmp(&opt.back(), &data, sizeof(A256Cmd)) != 0;
+	// setd and 100 times subd, jrnz: 201 instructions, the stop is the 202nd
+	failures += t.run(opt, false, 201) != A256Machine::faultBudget || t.vm.fault_value != 201;
+	failures += t.run(opt, false, 202) != A256Machine::faultNone;
+	return failures;
+}
+
+u32 test_jit_branch() // JIT and interpreter agree on branches on immediates (jrz 0 is always taken, jrnz 0 never)
+{
+	if (!A256Jit::supported_cpu())
+	{
+		return 0;
+	}
+	const char* const text =
+		"setd $01, 0\n"
+		"setd $04.ud0, 3\n"
+		"@L:\n"
+		"jrz 0, @A\n"
+		"adddi $01.ud0, 1\n"
+		"@A:\n"
+		"jrnz 0, @B\n"
+		"adddi $01.ud1, 1\n"
+		"@B:\n"
+		"jrz 1, @C\n"
+		"adddi $01.ud2, 1\n"
+		"@C:\n"
+		"jrnz 1, @D\n"
+		"adddi $01.ud3, 1\n"
+		"@D:\n"
+		"subd $04.ud0, $04.ud0, 1\n"
+		"jrnz $04.ud0, @L\n"
+		"stop $01.sq0, 0\n";
+	A256TestRun a, b;
+	const auto code = a.vm.compile(text);
+	const u32 fa = a.run(code);
+	const u32 fb = b.run(code, true);
+	u32 failures = fa != A256Machine::faultNone || fa != fb;
+	failures += memcmp(&a.vm.reg[1], &b.vm.reg[1], sizeof(A256Reg) * 255) != 0;
+	failures += a.vm.reg[1]._ud[0] != 0 || a.vm.reg[1]._ud[1] != 3 || a.vm.reg[1]._ud[2] != 3 || a.vm.reg[1]._ud[3] != 0;
+	return failures;
+}
+
+u32 test_print() // formatted output longer than the first guess of print()
+{
+	A256Machine vm;
+	std::string sunk;
+	vm.sink = [](void* context, const char* data, size_t size) { ((std::string*)context)->append(data, size); };
+	vm.sink_context = &sunk;
+	const std::string text(1000, 'x');
+	vm.print("%s|%d", text.c_str(), 42);
+	vm.print("");
+	vm.flush();
+	return sunk != text + "|42";
+}
+
+u32 test_image() // cache hit after save, unwritable cache is a miss with the program kept in memory
+{
+	u32 failures = 0;
+	A256Machine vm;
+	const std::string text = "setd $01, 7\nstop $01.sq0, 0\n";
+	const std::string path = "a256test.a256o";
+	const size_t size = vm.compile(text).size();
+	{
+		A256Image image;
+		failures += image.load(vm, text, "a256-missing/a256test.a256o") || !image.code || image.size != size || image.header;
+	}
+	remove(path.c_str());
+	{
+		A256Image image;
+		failures += image.load(vm, text, path) || !image.header || image.size != size;
+	}
+	{
+		A256Image image;
+		failures += !image.load(vm, text, path) || image.size != size;
+		failures += image.load(vm, text + "\n", path); // other source
+	}
+	remove(path.c_str());
+	return failures;
+}
+
+u32 test_scheduler() // one worker gives every task one slice per round, in the order they were added
+{
+	struct Slices
+	{
+		std::vector<size_t> order; // task of every stop 11 (one per slice)
+		std::atomic<bool> added;
+	};
+	struct Task
+	{
+		Slices* slices;
+		size_t id;
+	};
+	const size_t count = 3;
+	const u32 iterations = 4;
+	Slices slices;
+	slices.added = false;
+	A256TestRun runs[count];
+	Task contexts[count];
+	std::vector<A256Machine::A256Threaded> programs;
+	const auto code = runs[0].vm.compile(
+		"@L:\n"
+		"stop $01, 11\n"
+		"subd $01.ud0, $01.ud0, 1\n"
+		"jrnz $01.ud0, @L\n"
+		"stop $00, 0\n");
+	for (size_t i = 0; i < count; i++)
+	{
+		A256Machine& vm = runs[i].vm;
+		programs.push_back(vm.decode(code));
+		runs[i].start(code);
+		vm.reg[1]._ud[0] = iterations;
+		contexts[i].slices = &slices;
+		contexts[i].id = i;
+		vm.out_limit = 0; // output of every slice goes to the sink at once
+		vm.sink_context = &contexts[i];
+		vm.sink = [](void* context, const char*, size_t)
+		{
+			Task& task = *(Task*)context;
+			while (!task.slices->added)
+			{
+				std::this_thread::yield(); // first slice waits for the other tasks to be queued
+			}
+			task.slices->order.push_back(task.id);
+		};
+	}
+	u32 failures = 0;
+	A256Scheduler scheduler(1, 3); // slice: one iteration
+	for (size_t i = 0; i < count; i++)
+	{
+		scheduler.add(runs[i].vm, programs[i]);
+	}
+	slices.added = true;
+	scheduler.wait();
+	failures += slices.order.size() != count * iterations;
+	for (size_t i = 0; i < slices.order.size(); i++)
+	{
+		failures += slices.order[i] != i % count;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		failures += scheduler.task(i).status != A256Machine::faultNone || scheduler.task(i).slices != iterations + 1;
+	}
+	return failures;
+}
+
+u32 test_fork() // forks see the snapshot, not each other's or the source's later writes
+{
+	u32 failures = 0;
+	std::unique_ptr<A256Machine> machines[3]; // on the heap like A256Batch workers
+	for (auto& machine : machines)
+	{
+		machine.reset(new A256Machine);
+	}
+	A256Machine& vm = *machines[0];
+	A256Machine& a = *machines[1];
+	A256Machine& b = *machines[2];
+	const auto code = vm.compile(
+		"setd $02, 0\n"
+		"setd $02.ud0, 0x10000\n"
+		"setd $04, 7\n"
+		"stm $04, $02.uq0, $03.uq0\n"
+		"stop $00, 0\n"
+		"ld $05, $02.uq0, $03.uq0\n" // forks continue here: increment the stored value
+		"addd $05, $05, 1\n"
+		"stm $05, $02.uq0, $03.uq0\n"
+		"stop $00, 0\n");
+	A256Memory source(0x20000), fa(0x20000), fb(0x20000);
+	const auto program = source.load(vm, code);
+	failures += vm.run(program) != A256Machine::faultNone;
+	A256Snapshot snapshot(vm);
+	source.base[0x10000] = 9; // after the snapshot
+	fa.fork(a, snapshot);
+	failures += a.run(program) != A256Machine::faultNone || a.reg[5]._ud[0] != 8;
+	fb.fork(b, snapshot);
+	failures += b.run(program) != A256Machine::faultNone || b.reg[5]._ud[0] != 8;
+	failures += fa.base[0x10000] != 8 || fb.base[0x10000] != 8 || source.base[0x10000] != 9;
+	fa.fork(a, snapshot); // again over a used fork
+	failures += fa.base[0x10000] != 7;
+	A256Memory other(0x40000);
+	u8* const base = other.base;
+	try
+	{
+		other.fork(a, snapshot);
+		failures++;
+	}
+	catch (std::string&)
+	{
+		failures += other.base != base; // unchanged when the fork fails
+	}
+	return failures;
+}
+
+u32 test_store() // masked stm writes only the selected dwords, the rest of the 32 bytes is not accessed
+{
+	u32 failures = 0;
+	A256TestRun t;
+	const auto code = t.vm.compile(
+		"setd $04, 7\n"
+		"stm $04.ud1, $02.uq0, $03.uq0\n"
+		"stm $04.ud0, $05.uq0, $03.uq0\n"
+		"stop $00, 0\n");
+	std::vector<u32> buffer(24, 0xaaaaaaaa);
+	A256Memory memory(0x10000); // host pointers: the page after the accessible tail is inaccessible
+	u32* const last = (u32*)(memory.base + memory.size + A256Memory::page) - 1;
+	t.start(code);
+	t.vm.reg[2]._uq[0] = (u64)&buffer[8];
+	t.vm.reg[5]._uq[0] = (u64)last;
+	failures += t.vm.run(t.vm.decode(code)) != A256Machine::faultNone;
+	for (size_t i = 0; i < buffer.size(); i++)
+	{
+		failures += buffer[i] != (i == 9 ? 7 : 0xaaaaaaaa);
+	}
+	failures += *last != 7;
+	return failures;
+}
+
+template<typename Tin, typename Tout>
+u32 test_convert_pair(std::vector<A256Reg>& data) // vectorized conversion against the reference, registers that differ
+{
+	u32 failures = 0;
+	for (auto& x : data)
+	{
+		const A256Reg a = A256ConvertLanes<Tin, Tout>::convert(x);
+		const A256Reg b = A256Convert<Tin, Tout>::convert(x);
+		failures += memcmp(&a, &b, sizeof(A256Reg)) != 0;
+	}
+	return failures;
+}
+
+template<typename Tin>
+u32 test_converts(std::vector<A256Reg>& samples) // Tin to every lane type, 8- and 16-bit inputs exhaustively
+{
+	std::vector<A256Reg>& data = sizeof(Tin) <= 2 ? convert_words() : samples;
+	return test_convert_pair<Tin, u8>(data) + test_convert_pair<Tin, s8>(data) + test_convert_pair<Tin, u16>(data) + test_convert_pair<Tin, s16>(data) +
+		test_convert_pair<Tin, u32>(data) + test_convert_pair<Tin, s32>(data) + test_convert_pair<Tin, u64>(data) + test_convert_pair<Tin, s64>(data) +
+		test_convert_pair<Tin, f32>(data) + test_convert_pair<Tin, f64>(data);
+}
+
+u32 test_convert() // every pair of lane types (bsc1 conversions)
+{
+	std::vector<A256Reg> samples = convert_samples();
+	return test_converts<u8>(samples) + test_converts<s8>(samples) + test_converts<u16>(samples) + test_converts<s16>(samples) +
+		test_converts<u32>(samples) + test_converts<s32>(samples) + test_converts<u64>(samples) + test_converts<s64>(samples) +
+		test_converts<f32>(samples) + test_converts<f64>(samples);
+}
+
+u32 test_find() // every registered handler is found, at its lowest opcode
+{
+	u32 failures = 0;
+	A256Machine vm;
+	for (u32 i = 0; i <= vm.instr.max_num; i++)
+	{
+		const auto f = vm.instr.func[i];
+		if (f != nullptr)
+		{
+			const u16 code = vm.instr.find(f);
+			failures += code > i || vm.instr.func[code] != f;
+		}
+	}
+	failures += vm.instr.find(&A256Machine::jrnz) != vm.instr.opcodes.at("jrnz");
+	return failures;
+}
+
+u32 tests()
+{
+	u32 failures = 0;
+	const auto check = [&](const char* name, u32 (*test)())
+	{
+		const u32 n = test();
+		printf("%-12s %s (%u failures)\n", name, n ? "FAILED" : "ok", n);
+		failures += n;
+	};
+	check("find", test_find);
+	check("optimize", test_optimize);
+	check("fused", test_fused);
+	check("jit branch", test_jit_branch);
+	check("print", test_print);
+	check("image", test_image);
+	check("scheduler", test_scheduler);
+	check("fork", test_fork);
+	check("store", test_store);
+	check("convert", test_convert);
+	return failures;
+}